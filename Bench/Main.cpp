@@ -0,0 +1,428 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <Scenes/Component.hpp>
+#include <Scenes/Entity.inl>
+#include <Scenes/System.hpp>
+#include <Scenes/Scene.hpp>
+#include <Scenes/SpatialIndex.hpp>
+
+using namespace acid;
+
+class Position : public Component {
+public:
+	float x = 0.0f, y = 0.0f, z = 0.0f;
+};
+
+class Velocity : public Component {
+public:
+	float x = 1.0f, y = 2.0f, z = 3.0f;
+};
+
+class Health : public Component {
+public:
+	float value = 100.0f;
+};
+
+class MoveSystem : public System {
+public:
+	MoveSystem() {
+		GetFilter().Require<Position>();
+		GetFilter().Require<Velocity>();
+	}
+
+	void Update(float delta) override {
+		ForEach([delta](Entity, Position *position, const Velocity *velocity) {
+			position->x += velocity->x * delta;
+			position->y += velocity->y * delta;
+			position->z += velocity->z * delta;
+		});
+	}
+};
+
+class MoveGetComponentSystem : public System {
+public:
+	MoveGetComponentSystem() {
+		GetFilter().Require<Position>();
+		GetFilter().Require<Velocity>();
+	}
+
+	void Update(float delta) override {
+		ForEach([delta](Entity entity) {
+			auto position = entity.GetComponent<Position>();
+			auto velocity = entity.GetComponent<Velocity>();
+			position->x += velocity->x * delta;
+			position->y += velocity->y * delta;
+			position->z += velocity->z * delta;
+		});
+	}
+};
+
+class MoveGroupSystem : public System {
+public:
+	MoveGroupSystem() {
+		OwnGroup<Position, Velocity>();
+	}
+
+	void Update(float delta) override {
+		ForEachGroup([delta](Entity, Position *position, const Velocity *velocity) {
+			position->x += velocity->x * delta;
+			position->y += velocity->y * delta;
+			position->z += velocity->z * delta;
+		});
+	}
+};
+
+class ChangedSystem : public System {
+public:
+	ChangedSystem() {
+		GetFilter().Changed<Position>();
+	}
+
+	void Update(float) override {
+		ForEach([this](Entity, const Position *position) {
+			sum += position->x;
+		});
+	}
+
+	float sum = 0.0f;
+};
+
+class HealthSystem : public System {
+public:
+	HealthSystem() {
+		GetFilter().Require<Health>();
+	}
+};
+
+class BenchScene : public Scene {
+public:
+	BenchScene() : Scene(nullptr) {}
+	using Scene::Update;
+	void Start() override {}
+	void Update() override {}
+	bool IsPaused() const override { return false; }
+};
+
+using Clock = std::chrono::steady_clock;
+
+class Benchmark {
+public:
+	/// Benchmark name.
+	std::string name;
+
+	/// Runs one repetition for an Entity count, returns the measured time.
+	std::function<Clock::duration(std::size_t)> run;
+};
+
+class Result {
+public:
+	std::string name;
+	std::size_t entities;
+	std::size_t repeats;
+	double medianNs;
+	double minNs;
+};
+
+/**
+ * Creates Entities with Position and Velocity Components, and processes their actions.
+ * @param scene The scene.
+ * @param count The number of Entities.
+ * @return The Entities.
+ */
+std::vector<Entity> Populate(Scene &scene, std::size_t count) {
+	auto entities = scene.CreateEntities(count, Position(), Velocity());
+	scene.Update(0.0f);
+	return entities;
+}
+
+std::vector<Benchmark> GetBenchmarks() {
+	return {
+		{"entity_create_destroy", [](std::size_t count) {
+			BenchScene scene;
+			scene.AddSystem<MoveSystem>();
+			std::vector<Entity> entities;
+			entities.reserve(count);
+
+			const auto start = Clock::now();
+
+			for (std::size_t i = 0; i < count; ++i) {
+				entities.emplace_back(scene.CreateEntity());
+			}
+
+			scene.Update(0.0f);
+
+			for (auto &entity : entities) {
+				entity.Remove();
+			}
+
+			scene.Update(0.0f);
+			return Clock::now() - start;
+		}},
+		{"component_add_remove", [](std::size_t count) {
+			BenchScene scene;
+			scene.AddSystem<MoveSystem>();
+			scene.AddSystem<HealthSystem>();
+			auto entities = Populate(scene, count);
+
+			const auto start = Clock::now();
+
+			for (auto &entity : entities) {
+				entity.AddComponent<Health>();
+			}
+
+			scene.Update(0.0f);
+
+			for (auto &entity : entities) {
+				entity.RemoveComponent<Health>();
+			}
+
+			scene.Update(0.0f);
+			return Clock::now() - start;
+		}},
+		{"system_foreach", [](std::size_t count) {
+			BenchScene scene;
+			scene.AddSystem<MoveSystem>();
+			Populate(scene, count);
+
+			const auto start = Clock::now();
+			scene.Update(1.0f / 60.0f);
+			return Clock::now() - start;
+		}},
+		{"system_foreach_get_component", [](std::size_t count) {
+			BenchScene scene;
+			scene.AddSystem<MoveGetComponentSystem>();
+			Populate(scene, count);
+
+			const auto start = Clock::now();
+			scene.Update(1.0f / 60.0f);
+			return Clock::now() - start;
+		}},
+		{"system_foreach_group", [](std::size_t count) {
+			BenchScene scene;
+			scene.AddSystem<MoveGroupSystem>();
+			Populate(scene, count);
+
+			const auto start = Clock::now();
+			scene.Update(1.0f / 60.0f);
+			return Clock::now() - start;
+		}},
+		{"system_foreach_changed", [](std::size_t count) {
+			BenchScene scene;
+			scene.AddSystem<ChangedSystem>();
+			auto entities = Populate(scene, count);
+
+			// One Entity in ten has moved since the last update.
+			for (std::size_t i = 0; i < entities.size(); i += 10) {
+				entities[i].MarkChanged<Position>();
+			}
+
+			const auto start = Clock::now();
+			scene.Update(1.0f / 60.0f);
+			return Clock::now() - start;
+		}},
+		{"hierarchy_propagate", [](std::size_t count) {
+			BenchScene scene;
+			auto entities = Populate(scene, count);
+
+			// A tree of four children per Entity, parented out of order so the depth first order differs from the pool order.
+			for (std::size_t i = entities.size(); i-- > 1;) {
+				entities[i].SetParent(entities[(i - 1) / 4]);
+			}
+
+			// A first pass builds the order and its scratch storage, as in the frames before the measured one.
+			scene.PropagateHierarchy<Position>([](Position &, const Position *) {
+			});
+
+			// The root has moved, so the whole tree is propagated.
+			entities.front().MarkChanged<Position>();
+
+			const auto start = Clock::now();
+			scene.PropagateHierarchy<Position>([](Position &position, const Position *parent) {
+				if (parent) {
+					position.x += parent->x;
+					position.y += parent->y;
+					position.z += parent->z;
+				}
+			});
+			return Clock::now() - start;
+		}},
+		{"spatial_rebuild", [](std::size_t count) {
+			BenchScene scene;
+			scene.AddSystem<MoveSystem>();
+			auto entities = Populate(scene, count);
+			SpatialIndex<Position> index(scene, 2.0f, [](const Position &position) {
+				return SpatialGrid::Sphere{{position.x, position.y, position.z}, 0.5f};
+			});
+
+			// Entities spread over a cube, about one per cell, and a first build as in the frames before the measured one.
+			const auto side = static_cast<std::size_t>(std::cbrt(static_cast<double>(count))) + 1;
+
+			for (std::size_t i = 0; i < entities.size(); ++i) {
+				auto position = entities[i].GetComponent<Position>();
+				position->x = static_cast<float>(i % side) * 2.0f;
+				position->y = static_cast<float>(i / side % side) * 2.0f;
+				position->z = static_cast<float>(i / (side * side)) * 2.0f;
+			}
+
+			index.Update();
+			scene.Update(1.0f / 60.0f);
+
+			const auto start = Clock::now();
+			index.Update();
+			return Clock::now() - start;
+		}},
+		{"spatial_query", [](std::size_t count) {
+			BenchScene scene;
+			auto entities = Populate(scene, count);
+			SpatialIndex<Position> index(scene, 2.0f, [](const Position &position) {
+				return SpatialGrid::Sphere{{position.x, position.y, position.z}, 0.5f};
+			});
+
+			const auto side = static_cast<std::size_t>(std::cbrt(static_cast<double>(count))) + 1;
+			std::vector<SpatialGrid::Sphere> queries;
+
+			for (std::size_t i = 0; i < entities.size(); ++i) {
+				auto position = entities[i].GetComponent<Position>();
+				position->x = static_cast<float>(i % side) * 2.0f;
+				position->y = static_cast<float>(i / side % side) * 2.0f;
+				position->z = static_cast<float>(i / (side * side)) * 2.0f;
+				queries.emplace_back(SpatialGrid::Sphere{{position->x, position->y, position->z}, 2.0f});
+			}
+
+			index.Update();
+			SpatialGrid::Results results;
+
+			// A neighbour query around each Entity.
+			const auto start = Clock::now();
+			index.Query(queries.data(), queries.size(), results);
+			return Clock::now() - start;
+		}},
+		{"update_entities", [](std::size_t count) {
+			BenchScene scene;
+			scene.AddSystem<MoveSystem>();
+			scene.AddSystem<HealthSystem>();
+
+			for (std::size_t i = 0; i < count; ++i) {
+				auto entity = scene.CreateEntity();
+				entity.AddComponent<Position>();
+				entity.AddComponent<Velocity>();
+			}
+
+			// Only the pending Enable and Refresh actions are measured, the Systems do nothing else.
+			const auto start = Clock::now();
+			scene.Update(0.0f);
+			return Clock::now() - start;
+		}},
+		{"system_add_remove", [](std::size_t count) {
+			BenchScene scene;
+			Populate(scene, count);
+
+			const auto start = Clock::now();
+			scene.AddSystem<MoveSystem>();
+			scene.Update(0.0f);
+			scene.RemoveSystem<MoveSystem>();
+			return Clock::now() - start;
+		}},
+	};
+}
+
+/**
+ * Splits a comma separated list of numbers.
+ * @param list The list.
+ * @return The numbers.
+ */
+std::vector<std::size_t> ParseCounts(const std::string &list) {
+	std::vector<std::size_t> counts;
+	std::stringstream stream(list);
+	std::string item;
+
+	while (std::getline(stream, item, ',')) {
+		counts.emplace_back(std::stoul(item));
+	}
+
+	return counts;
+}
+
+void PrintCsv(const std::vector<Result> &results) {
+	std::cout << "benchmark,entities,repeats,median_ns,min_ns,median_ns_per_entity\n";
+
+	for (const auto &result : results) {
+		std::cout << result.name << ',' << result.entities << ',' << result.repeats << ',' << result.medianNs << ',' << result.minNs << ','
+			<< result.medianNs / result.entities << '\n';
+	}
+}
+
+void PrintJson(const std::vector<Result> &results) {
+	std::cout << "[\n";
+
+	for (std::size_t i = 0; i < results.size(); ++i) {
+		const auto &result = results[i];
+		std::cout << "  {\"benchmark\": \"" << result.name << "\", \"entities\": " << result.entities << ", \"repeats\": " << result.repeats
+			<< ", \"median_ns\": " << result.medianNs << ", \"min_ns\": " << result.minNs << ", \"median_ns_per_entity\": "
+			<< result.medianNs / result.entities << '}' << (i + 1 < results.size() ? "," : "") << '\n';
+	}
+
+	std::cout << "]\n";
+}
+
+int main(int argc, char **argv) {
+	std::vector<std::size_t> counts = {1000, 10000, 100000};
+	std::size_t repeats = 5;
+	std::string filter;
+	bool json = false;
+
+	for (int i = 1; i < argc; ++i) {
+		const std::string arg = argv[i];
+
+		if (arg == "--json") {
+			json = true;
+		} else if (arg == "--csv") {
+			json = false;
+		} else if (arg == "--entities" && i + 1 < argc) {
+			counts = ParseCounts(argv[++i]);
+		} else if (arg == "--repeats" && i + 1 < argc) {
+			repeats = std::max<std::size_t>(std::stoul(argv[++i]), 1);
+		} else if (arg == "--filter" && i + 1 < argc) {
+			filter = argv[++i];
+		} else {
+			std::cerr << "Usage: ECS_Bench [--csv | --json] [--entities 1000,10000] [--repeats 5] [--filter name]\n";
+			return EXIT_FAILURE;
+		}
+	}
+
+	std::vector<Result> results;
+	std::cout << std::fixed << std::setprecision(1);
+
+	for (const auto &benchmark : GetBenchmarks()) {
+		if (!filter.empty() && benchmark.name.find(filter) == std::string::npos) {
+			continue;
+		}
+
+		for (const auto &count : counts) {
+			std::vector<double> times;
+
+			for (std::size_t r = 0; r < repeats; ++r) {
+				times.emplace_back(std::chrono::duration<double, std::nano>(benchmark.run(count)).count());
+			}
+
+			std::sort(times.begin(), times.end());
+			results.emplace_back(Result{benchmark.name, count, repeats, times[times.size() / 2], times.front()});
+		}
+	}
+
+	if (json) {
+		PrintJson(results);
+	} else {
+		PrintCsv(results);
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,91 @@
+#include "CommandBuffer.hpp"
+
+namespace acid {
+namespace {
+/// Order key of the commands recorded by this thread.
+thread_local std::uint64_t currentKey = 0;
+}
+
+CommandBuffer::Scope::Scope(std::uint64_t key) :
+	previous(currentKey) {
+	currentKey = key;
+}
+
+CommandBuffer::Scope::~Scope() {
+	currentKey = previous;
+}
+
+void *CommandBuffer::CountingResource::do_allocate(std::size_t bytes, std::size_t alignment) {
+	auto p = resource->allocate(bytes, alignment);
+	allocated += bytes;
+	return p;
+}
+
+void CommandBuffer::CountingResource::do_deallocate(void *p, std::size_t bytes, std::size_t alignment) {
+	resource->deallocate(p, bytes, alignment);
+	allocated -= bytes;
+}
+
+CommandBuffer::CommandBuffer() :
+	memory(&upstream) {
+}
+
+CommandBuffer::~CommandBuffer() {
+	Clear();
+}
+
+Entity::Id CommandBuffer::CreateEntity() {
+	const auto id = Entity::MakeId(pendingCount++, PendingVersion);
+	Record(Type::Create, id);
+	return id;
+}
+
+void CommandBuffer::RemoveEntity(Entity::Id id) {
+	Record(Type::Remove, id);
+}
+
+void CommandBuffer::EnableEntity(Entity::Id id) {
+	Record(Type::Enable, id);
+}
+
+void CommandBuffer::DisableEntity(Entity::Id id) {
+	Record(Type::Disable, id);
+}
+
+MemoryUsage CommandBuffer::GetMemoryUsage() const noexcept {
+	auto usage = MemoryUsage::Of(commands);
+	usage += MemoryUsage::Of(created);
+	usage += {componentBytes, upstream.allocated};
+	return usage;
+}
+
+std::uint64_t CommandBuffer::GetKey() noexcept {
+	return currentKey;
+}
+
+void CommandBuffer::SetKey(std::uint64_t key) noexcept {
+	currentKey = key;
+}
+
+CommandBuffer::Command &CommandBuffer::Record(Type type, Entity::Id id) {
+	auto &command = commands.emplace_back();
+	command.type = type;
+	command.key = currentKey;
+	command.id = id;
+	return command;
+}
+
+void CommandBuffer::Clear() noexcept {
+	for (auto &command : commands) {
+		if (command.component && command.destroy) {
+			command.destroy(command.component);
+		}
+	}
+
+	commands.clear();
+	created.clear();
+	pendingCount = 0;
+	componentBytes = 0;
+	memory.release();
+}
+}
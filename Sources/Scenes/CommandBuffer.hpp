@@ -0,0 +1,203 @@
+#pragma once
+
+#include <limits>
+#include <memory_resource>
+#include <new>
+#include <vector>
+
+#include "Utils/MemoryUsage.hpp"
+#include "Utils/NonCopyable.hpp"
+#include "Entity.hpp"
+
+namespace acid {
+/**
+ * @brief Records structural changes to apply to the Scene later, so Systems updated on worker threads can create and remove Entities,
+ * add and remove Components, and enable or disable Entities without locking. Each thread records into its own buffer,
+ * buffers are merged when the Scene updates its Entities, in an order that does not depend on which thread recorded what.
+ */
+class ACID_EXPORT CommandBuffer : public NonCopyable {
+	friend class Scene;
+public:
+	/// Version of the IDs returned by CreateEntity until the Entity is created.
+	static constexpr Entity::Version PendingVersion = std::numeric_limits<Entity::Version>::max() - 1;
+
+	/**
+	 * @brief Sets the order key of the commands recorded by the calling thread, restoring the previous key when destroyed.
+	 */
+	class ACID_EXPORT Scope {
+	public:
+		explicit Scope(std::uint64_t key);
+		~Scope();
+
+		Scope(const Scope &) = delete;
+		Scope &operator=(const Scope &) = delete;
+
+	private:
+		std::uint64_t previous;
+	};
+
+	CommandBuffer();
+	~CommandBuffer();
+
+	/**
+	 * Records the creation of an Entity.
+	 * @return A pending ID, only valid with this buffer until the commands are applied.
+	 */
+	Entity::Id CreateEntity();
+
+	/**
+	 * Records the removal of an Entity.
+	 * @param id The Entity ID, or a pending ID from this buffer.
+	 */
+	void RemoveEntity(Entity::Id id);
+
+	/**
+	 * Records enabling an Entity.
+	 * @param id The Entity ID, or a pending ID from this buffer.
+	 */
+	void EnableEntity(Entity::Id id);
+
+	/**
+	 * Records disabling an Entity.
+	 * @param id The Entity ID, or a pending ID from this buffer.
+	 */
+	void DisableEntity(Entity::Id id);
+
+	/**
+	 * Records adding a Component to an Entity, the Component is constructed now and moved into the Scene when applied.
+	 * @tparam T The Component type.
+	 * @tparam Args The constructor arg types.
+	 * @param id The Entity ID, or a pending ID from this buffer.
+	 * @param args The constructor arguments.
+	 */
+	template<typename T, typename... Args>
+	void AddComponent(Entity::Id id, Args &&...args) {
+		auto component = new(memory.allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+		componentBytes += sizeof(T);
+		auto &command = Record(Type::AddComponent, id);
+		command.component = component;
+		command.apply = [](Entity &entity, void *component) {
+			entity.AddComponent<T>(std::move(*static_cast<T *>(component)));
+		};
+		command.destroy = [](void *component) {
+			static_cast<T *>(component)->~T();
+		};
+	}
+
+	/**
+	 * Records removing a Component from an Entity.
+	 * @tparam T The Component type.
+	 * @param id The Entity ID, or a pending ID from this buffer.
+	 */
+	template<typename T>
+	void RemoveComponent(Entity::Id id) {
+		Record(Type::RemoveComponent, id).apply = [](Entity &entity, void *) {
+			entity.RemoveComponent<T>();
+		};
+	}
+
+	/**
+	 * Gets the number of recorded commands.
+	 * @return The number of commands.
+	 */
+	std::size_t GetSize() const noexcept { return commands.size(); }
+
+	/**
+	 * Gets the memory of the recorded commands, the created Entities and the recorded Components.
+	 * @return The memory usage, not counting memory owned by the Components themselves.
+	 */
+	MemoryUsage GetMemoryUsage() const noexcept;
+
+	/**
+	 * Makes an order key. Commands are applied by increasing key, then by recording order.
+	 * @param system The position of the System being updated, starting at 1, 0 outside of System updates.
+	 * @param chunk Increases through the update of a System, with each chunk of a parallel iteration.
+	 * @return The order key.
+	 */
+	static constexpr std::uint64_t MakeKey(std::uint32_t system, std::uint32_t chunk) noexcept {
+		return static_cast<std::uint64_t>(system) << 32 | chunk;
+	}
+
+	/**
+	 * Gets the order key of the commands recorded by the calling thread.
+	 * @return The order key.
+	 */
+	static std::uint64_t GetKey() noexcept;
+
+	/**
+	 * Sets the order key of the commands recorded by the calling thread.
+	 * @param key The order key.
+	 */
+	static void SetKey(std::uint64_t key) noexcept;
+
+	/**
+	 * Gets if an ID was returned by CreateEntity and is not created yet.
+	 * @param id The ID.
+	 * @return If the ID is pending.
+	 */
+	static constexpr bool IsPending(Entity::Id id) noexcept { return Entity::GetVersion(id) == PendingVersion; }
+
+private:
+	enum class Type {
+		Create, Remove, Enable, Disable, AddComponent, RemoveComponent
+	};
+
+	/**
+	 * @brief Upstream of the Component memory, counting the bytes it gave out.
+	 */
+	class CountingResource : public std::pmr::memory_resource {
+	public:
+		std::pmr::memory_resource *resource = std::pmr::get_default_resource();
+		std::size_t allocated = 0;
+
+	private:
+		void *do_allocate(std::size_t bytes, std::size_t alignment) override;
+		void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override;
+		bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+	};
+
+	class Command {
+	public:
+		Type type;
+
+		/// Order key, the System position in the high half and the chunk in the low half.
+		std::uint64_t key;
+
+		/// The Entity ID, or a pending ID.
+		Entity::Id id;
+
+		/// The Component to add, constructed in the buffer memory.
+		void *component = nullptr;
+		void (*apply)(Entity &entity, void *component) = nullptr;
+		void (*destroy)(void *component) = nullptr;
+	};
+
+	/**
+	 * Appends a command with the order key of the calling thread.
+	 * @param type The command type.
+	 * @param id The Entity ID.
+	 * @return The command.
+	 */
+	Command &Record(Type type, Entity::Id id);
+
+	/**
+	 * Destroys the recorded Components, applied or not, and removes all commands.
+	 */
+	void Clear() noexcept;
+
+	std::vector<Command> commands;
+
+	/// Entities created by applied commands, the index of this array matches the pending Entity index.
+	std::vector<Entity::Id> created;
+
+	/// Number of pending IDs given out since the last Clear.
+	Entity::Index pendingCount = 0;
+
+	/// Bytes of the recorded Components.
+	std::size_t componentBytes = 0;
+
+	/// Memory of the recorded Components, released in bulk once they have been applied.
+	CountingResource upstream;
+	std::pmr::monotonic_buffer_resource memory;
+};
+}
@@ -0,0 +1,37 @@
+#include "Component.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace acid {
+static std::vector<Component::RegisteredType> &GetRegisteredTypes() {
+	static std::vector<Component::RegisteredType> registeredTypes;
+	return registeredTypes;
+}
+
+const Component::RegisteredType *Component::GetRegisteredType(const std::string &name) {
+	const auto &registeredTypes = GetRegisteredTypes();
+	const auto it = std::find_if(registeredTypes.begin(), registeredTypes.end(), [&name](const RegisteredType &type) {
+		return type.name == name;
+	});
+	return it != registeredTypes.end() ? &*it : nullptr;
+}
+
+const Component::RegisteredType *Component::GetRegisteredType(TypeId typeId) {
+	const auto &registeredTypes = GetRegisteredTypes();
+	const auto it = std::find_if(registeredTypes.begin(), registeredTypes.end(), [typeId](const RegisteredType &type) {
+		return type.typeId == typeId;
+	});
+	return it != registeredTypes.end() ? &*it : nullptr;
+}
+
+void Component::AddRegisteredType(RegisteredType &&type) {
+	auto &registeredTypes = GetRegisteredTypes();
+
+	// Registering a name again replaces the previous type, as the factory does.
+	registeredTypes.erase(std::remove_if(registeredTypes.begin(), registeredTypes.end(), [&type](const RegisteredType &other) {
+		return other.name == type.name || other.typeId == type.typeId;
+	}), registeredTypes.end());
+	registeredTypes.emplace_back(std::move(type));
+}
+}
@@ -1,16 +1,33 @@
 #pragma once
 
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <type_traits>
+
 #include "Utils/TypeInfo.hpp"
 #include "Utils/Factory.hpp"
 
 #include "Export.hpp"
 
 namespace acid {
-// The maximum number of Components an Entity can holds.
-constexpr std::size_t MAX_COMPONENTS = 64;
+// The maximum number of Component types, an Entity only pays for the Components it holds.
+constexpr std::size_t MAX_COMPONENTS = 4096;
 
-class ACID_EXPORT Component : public Factory<Component> {
-};
+class Component;
+class ComponentPoolBase;
+enum class SnapshotFormat : std::uint32_t;
+
+/**
+ * Creates an empty pool for the Components of the type T.
+ * @tparam T The Component type.
+ * @param resource The memory resource the pool storage is allocated from.
+ * @return The Component pool.
+ */
+template<typename T>
+std::unique_ptr<ComponentPoolBase> CreateComponentPool(std::pmr::memory_resource *resource);
 
 /**
  * Gets the Type ID for the Component.
@@ -23,4 +40,118 @@ TypeId GetComponentTypeId() noexcept {
 
 	return TypeInfo<Component>::GetTypeId<T>();
 }
+
+class ACID_EXPORT Component : public Factory<Component> {
+public:
+	/**
+	 * @brief A Component type registered by name, the name keys the type in Scene snapshots.
+	 */
+	class RegisteredType {
+	public:
+		std::string name;
+		TypeId typeId;
+		std::unique_ptr<ComponentPoolBase> (*createPool)(std::pmr::memory_resource *resource);
+
+		/// How the Components are stored in snapshots, and the size of a plain record, so records can be checked without a pool.
+		SnapshotFormat snapshotFormat;
+		std::size_t snapshotStride;
+	};
+
+	/**
+	 * @brief Registers a Component type with the factory, and records its name and type ID.
+	 * @tparam T The Component type.
+	 */
+	template<typename T>
+	class Registrar : public Factory<Component>::Registrar<T> {
+	protected:
+		static bool Register(const std::string &name);
+	};
+
+	/**
+	 * Gets a registered Component type by name.
+	 * @param name The registered name.
+	 * @return The registered type, or nullptr if no type is registered with this name.
+	 */
+	static const RegisteredType *GetRegisteredType(const std::string &name);
+
+	/**
+	 * Gets a registered Component type by type ID.
+	 * @param typeId The Component type ID.
+	 * @return The registered type, or nullptr if the type has not been registered.
+	 */
+	static const RegisteredType *GetRegisteredType(TypeId typeId);
+
+private:
+	static void AddRegisteredType(RegisteredType &&type);
+};
+
+/**
+ * How the Components of a type are stored in Scene snapshots.
+ */
+enum class SnapshotFormat : std::uint32_t {
+	/// The Components are not stored.
+	None,
+	/// Each Component is stored as a trivially copyable record, copied as is. The Component declares the record type as
+	/// SnapshotData, and provides `SnapshotData GetSnapshotData() const` and `void SetSnapshotData(const SnapshotData &)`.
+	Plain,
+	/// Each Component writes and reads itself, through `void WriteSnapshot(std::ostream &) const` and `void ReadSnapshot(std::istream &)`.
+	Stream
+};
+
+template<typename T, typename U = void>
+struct has_snapshot_data : std::false_type {
+};
+
+template<typename T>
+struct has_snapshot_data<T, std::void_t<typename T::SnapshotData, decltype(std::declval<T &>().SetSnapshotData(std::declval<const T &>().GetSnapshotData()))>> :
+	std::is_trivially_copyable<typename T::SnapshotData> {
+};
+
+template<typename T, typename U = void>
+struct has_snapshot_stream : std::false_type {
+};
+
+template<typename T>
+struct has_snapshot_stream<T, std::void_t<decltype(std::declval<const T &>().WriteSnapshot(std::declval<std::ostream &>())),
+	decltype(std::declval<T &>().ReadSnapshot(std::declval<std::istream &>()))>> : std::true_type {
+};
+
+/**
+ * Gets how the Components of a type are stored in Scene snapshots, a plain record is preferred over streaming.
+ * @tparam T The Component type.
+ * @return The snapshot format.
+ */
+template<typename T>
+constexpr SnapshotFormat GetSnapshotFormat() noexcept {
+	if constexpr (!std::is_default_constructible_v<T>) {
+		return SnapshotFormat::None;
+	} else if constexpr (has_snapshot_data<T>::value) {
+		return SnapshotFormat::Plain;
+	} else if constexpr (has_snapshot_stream<T>::value) {
+		return SnapshotFormat::Stream;
+	} else {
+		return SnapshotFormat::None;
+	}
+}
+
+/**
+ * Gets the size of the plain snapshot record of a Component type.
+ * @tparam T The Component type.
+ * @return The record size, 0 if the Components are not stored as plain records.
+ */
+template<typename T>
+constexpr std::size_t GetSnapshotStride() noexcept {
+	if constexpr (GetSnapshotFormat<T>() == SnapshotFormat::Plain) {
+		return sizeof(typename T::SnapshotData);
+	} else {
+		return 0;
+	}
+}
+
+template<typename T>
+bool Component::Registrar<T>::Register(const std::string &name) {
+	Factory<Component>::Registrar<T>::Register(name);
+	AddRegisteredType({name, GetComponentTypeId<T>(), &CreateComponentPool<T>, GetSnapshotFormat<T>(), GetSnapshotStride<T>()});
+	return true;
+}
 }
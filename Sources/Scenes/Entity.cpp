@@ -9,6 +9,10 @@ Entity::Entity(Id id, Scene *scene) :
 }
 
 void Entity::RemoveAllComponents() {
+	if (!scene->IsEntityValid(id)) {
+		throw std::runtime_error("Entity ID is not valid");
+	}
+
 	scene->components.RemoveAllComponents(id);
 	scene->RefreshEntity(id);
 }
@@ -37,6 +41,20 @@ void Entity::Remove() {
 	scene->RemoveEntity(id);
 }
 
+std::optional<Entity> Entity::GetParent() const {
+	const auto parent = scene->hierarchy.GetParent(id);
+
+	if (parent == NullId) {
+		return std::nullopt;
+	}
+
+	return Entity(parent, scene);
+}
+
+void Entity::SetParent(Id parent) {
+	scene->SetParent(id, parent);
+}
+
 bool Entity::operator==(const Entity &other) const {
 	return id == other.id && scene == other.scene;
 }
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <cstdint>
+#include <limits>
+#include <optional>
+
 #include "Component.hpp"
 
 namespace acid {
@@ -7,14 +11,43 @@ class Scene;
 
 class ACID_EXPORT Entity {
 public:
-	// Entity ID type.
-	using Id = std::size_t;
+	// Entity ID type, a handle packing the Entity index in the low 32 bits and its version in the high 32 bits.
+	using Id = std::uint64_t;
+	// Entity index type, the slot of the Entity within the Scene storage.
+	using Index = std::uint32_t;
+	// Entity version type, incremented each time an Entity index is recycled.
+	using Version = std::uint32_t;
+
+	// The ID of an Entity that does not refer to any slot.
+	static constexpr Id NullId = std::numeric_limits<Id>::max();
 
 	Entity() = default;
 	Entity(Id id, Scene *scene);
 
 	~Entity() = default;
 
+	/**
+	 * Packs an Entity index and version into an Entity ID.
+	 * @param index The Entity index.
+	 * @param version The Entity version.
+	 * @return The Entity ID.
+	 */
+	static constexpr Id MakeId(Index index, Version version) noexcept { return static_cast<Id>(version) << 32 | index; }
+
+	/**
+	 * Gets the index part of an Entity ID.
+	 * @param id The Entity ID.
+	 * @return The Entity index.
+	 */
+	static constexpr Index GetIndex(Id id) noexcept { return static_cast<Index>(id); }
+
+	/**
+	 * Gets the version part of an Entity ID.
+	 * @param id The Entity ID.
+	 * @return The Entity version.
+	 */
+	static constexpr Version GetVersion(Id id) noexcept { return static_cast<Version>(id >> 32); }
+
 	/**
 	 * Casts the Entity into its ID.
 	 * @return The Entity ID.
@@ -27,6 +60,18 @@ public:
 	 */
 	Id GetId() const noexcept { return id; }
 
+	/**
+	 * Gets the Entity index.
+	 * @return The Entity index.
+	 */
+	Index GetIndex() const noexcept { return GetIndex(id); }
+
+	/**
+	 * Gets the Entity version.
+	 * @return The Entity version.
+	 */
+	Version GetVersion() const noexcept { return GetVersion(id); }
+
 	/**
 	 * Checks whether the Entity has the Component or not.
 	 * @tparam T The Component type.
@@ -43,6 +88,14 @@ public:
 	template<typename T>
 	T *GetComponent() const;
 
+	/**
+	 * Marks the Component of the Entity as changed, for Systems filtering on changed Components.
+	 * Components taken through a non const pointer by typed System iteration are marked already.
+	 * @tparam T The Component type.
+	 */
+	template<typename T>
+	void MarkChanged() const;
+
 	/**
 	 * Adds the Component to the Entity.
 	 * @tparam T The Component type.
@@ -54,7 +107,8 @@ public:
 	T *AddComponent(Args &&...args);
 
 	/**
-	 * Adds the Component to the Entity.
+	 * Adds the Component to the Entity, the Component is moved into the Component pool of T.
+	 * Throws if the Component is null, or if its dynamic type is not exactly T, as a derived object would be sliced.
 	 * @tparam T The Component type.
 	 * @param component The component to add to the Entity.
 	 * @return The Component.
@@ -62,6 +116,15 @@ public:
 	template<typename T>
 	T *AddComponent(std::unique_ptr<T> &&component);
 
+	/**
+	 * Adds several Components to the Entity at once, refreshing the Entity a single time.
+	 * @tparam Ts The Component types.
+	 * @param components The Components to add to the Entity.
+	 * @return The Components.
+	 */
+	template<typename... Ts>
+	std::tuple<std::decay_t<Ts> *...> AddComponents(Ts &&...components);
+
 	/**
 	 * Removes the Component from the Entity.
 	 * @tparam T The Component type.
@@ -103,16 +166,28 @@ public:
 	bool IsValid() const;
 
 	/**
-	 * Removes the Entity.
+	 * Removes the Entity, and its descendants.
 	 */
 	void Remove();
 
+	/**
+	 * Gets the parent of the Entity.
+	 * @return The parent Entity, if the Entity has one.
+	 */
+	std::optional<Entity> GetParent() const;
+
+	/**
+	 * Sets the parent of the Entity.
+	 * @param parent The parent Entity ID, NullId removes the Entity from its parent.
+	 */
+	void SetParent(Id parent);
+
 	bool operator==(const Entity &other) const;
 	bool operator!=(const Entity &other) const;
 
 private:
 	/// Entity ID.
-	Id id = 0;
+	Id id = NullId;
 
 	/// The Scene that this Entity belongs to.
 	Scene *scene = nullptr;
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <stdexcept>
+#include <typeinfo>
+
 #include "Entity.hpp"
 #include "Scene.hpp"
 
@@ -14,22 +17,60 @@ T *Entity::GetComponent() const {
 	return scene->components.GetComponent<T>(id);
 }
 
+template<typename T>
+void Entity::MarkChanged() const {
+	scene->components.MarkChanged<T>(id);
+}
+
 template<typename T, typename... Args>
 T *Entity::AddComponent(Args &&...args) {
-	scene->components.AddComponent<T>(id, std::make_unique<T>(std::forward<Args>(args)...));
+	// A stale ID shares its index with a live Entity, it must not reach the per index Component state.
+	if (!scene->IsEntityValid(id)) {
+		throw std::runtime_error("Entity ID is not valid");
+	}
+
+	auto result = scene->components.AddComponent<T>(id, std::forward<Args>(args)...);
 	scene->RefreshEntity(id);
-	return GetComponent<T>();
+	return result;
 }
 
 template<typename T>
 T *Entity::AddComponent(std::unique_ptr<T> &&component) {
-	scene->components.AddComponent<T>(id, std::move(component));
+	if (!scene->IsEntityValid(id)) {
+		throw std::runtime_error("Entity ID is not valid");
+	}
+
+	if (!component) {
+		throw std::runtime_error("Component is null");
+	}
+
+	// The pool of T only stores T, moving a derived object into it would slice it.
+	if (typeid(*component) != typeid(T)) {
+		throw std::runtime_error("Component type does not match the pool type");
+	}
+
+	auto result = scene->components.AddComponent<T>(id, std::move(*component));
+	scene->RefreshEntity(id);
+	return result;
+}
+
+template<typename... Ts>
+std::tuple<std::decay_t<Ts> *...> Entity::AddComponents(Ts &&...components) {
+	if (!scene->IsEntityValid(id)) {
+		throw std::runtime_error("Entity ID is not valid");
+	}
+
+	auto result = scene->components.AddComponents(id, std::forward<Ts>(components)...);
 	scene->RefreshEntity(id);
-	return GetComponent<T>();
+	return result;
 }
 
 template<typename T>
 void Entity::RemoveComponent() {
+	if (!scene->IsEntityValid(id)) {
+		throw std::runtime_error("Entity ID is not valid");
+	}
+
 	scene->components.RemoveComponent<T>(id);
 	scene->RefreshEntity(id);
 }
@@ -2,29 +2,30 @@
 
 namespace acid {
 bool ComponentFilter::Check(const Mask &mask) const {
-	const auto excludeMask = excluded & mask;
+	// No excluded component and no required component missing.
+	return mask.Contains(required) && !mask.Intersects(excluded);
+}
 
-	// Checks if there is an excluded component.
-	if (excludeMask.any()) {
-		return false;
-	}
+void ComponentFilter::Check(const Mask *masks, std::size_t count, std::uint8_t *results) const {
+	Mask::Match(masks, count, required, excluded, results);
+}
 
-	for (std::size_t i = 0; i < required.size(); ++i) {
-		if (required[i] && !mask[i]) {
-			// A required component is missing.
-			return false;
-		}
+bool ComponentFilter::Conflicts(const ComponentFilter &other) const {
+	if (!accessDeclared || !other.accessDeclared) {
+		return true;
 	}
 
-	return true;
+	return writes.Intersects(other.reads | other.writes) || other.writes.Intersects(reads);
 }
 
-void ComponentFilter::ExcludeNotRequired() noexcept {
+void ComponentFilter::ExcludeNotRequired() {
 	excluded = ~required;
 }
 
-void ComponentFilter::ExcludeAll() noexcept {
-	required.reset();
-	excluded.set();
+void ComponentFilter::ExcludeAll() {
+	required.Clear();
+	excluded = ~Mask();
+	added.Clear();
+	changed.Clear();
 }
 }
@@ -1,12 +1,16 @@
 #pragma once
 
-#include <bitset>
+#include <cstdint>
+
 #include "Scenes/Component.hpp"
+#include "ComponentMask.hpp"
 
 namespace acid {
 class ACID_EXPORT ComponentFilter {
 public:
-	using Mask = std::bitset<MAX_COMPONENTS>;
+	using Mask = ComponentMask;
+
+	static_assert(MAX_COMPONENTS <= Mask::MaxBits, "Component masks must hold every Component type ID.");
 
 	ComponentFilter() = default;
 	~ComponentFilter() = default;
@@ -18,14 +22,22 @@ public:
 	 */
 	bool Check(const Mask &mask) const;
 
+	/**
+	 * Checks if a range of Entities match the requirements.
+	 * @param masks The requirements masks.
+	 * @param count The number of masks.
+	 * @param results Set to 1 for each mask that matches, 0 otherwise.
+	 */
+	void Check(const Mask *masks, std::size_t count, std::uint8_t *results) const;
+
 	/**
 	 * Makes a Component required.
 	 * @tparam T The Component type.
 	 */
 	template<typename T>
 	void Require() {
-		required.set(GetComponentTypeId<T>());
-		excluded.reset(GetComponentTypeId<T>());
+		required.Set(GetComponentTypeId<T>());
+		excluded.Reset(GetComponentTypeId<T>());
 	}
 
 	/**
@@ -34,19 +46,42 @@ public:
 	 */
 	template<typename T>
 	void Exclude() {
-		required.reset(GetComponentTypeId<T>());
-		excluded.set(GetComponentTypeId<T>());
+		required.Reset(GetComponentTypeId<T>());
+		excluded.Set(GetComponentTypeId<T>());
+		added.Reset(GetComponentTypeId<T>());
+		changed.Reset(GetComponentTypeId<T>());
+	}
+
+	/**
+	 * Makes a Component required, and only iterates the Entities whose Component was added since the System last ran.
+	 * @tparam T The Component type.
+	 */
+	template<typename T>
+	void Added() {
+		Require<T>();
+		added.Set(GetComponentTypeId<T>());
+	}
+
+	/**
+	 * Makes a Component required, and only iterates the Entities whose Component was added or changed since the System last ran.
+	 * Components are changed by typed System iteration through a non const pointer, or marked with Entity::MarkChanged.
+	 * @tparam T The Component type.
+	 */
+	template<typename T>
+	void Changed() {
+		Require<T>();
+		changed.Set(GetComponentTypeId<T>());
 	}
 
 	/**
 	 * Exclude all Components that are not required.
 	 */
-	void ExcludeNotRequired() noexcept;
+	void ExcludeNotRequired();
 
 	/**
 	 * Exclude all Components.
 	 */
-	void ExcludeAll() noexcept;
+	void ExcludeAll();
 
 	/**
 	 * Removes a Component from both required and excluded lists.
@@ -54,12 +89,89 @@ public:
 	 */
 	template<typename T>
 	void Ignore() {
-		required.reset(GetComponentTypeId<T>());
-		excluded.reset(GetComponentTypeId<T>());
+		required.Reset(GetComponentTypeId<T>());
+		excluded.Reset(GetComponentTypeId<T>());
+		added.Reset(GetComponentTypeId<T>());
+		changed.Reset(GetComponentTypeId<T>());
 	}
 
+	/**
+	 * Declares that the System reads the Component during Update.
+	 * Systems that declare their Component access can be updated in parallel with Systems they do not conflict with.
+	 * @tparam T The Component type.
+	 */
+	template<typename T>
+	void Read() {
+		reads.Set(GetComponentTypeId<T>());
+		accessDeclared = true;
+		++accessVersion;
+	}
+
+	/**
+	 * Declares that the System writes the Component during Update.
+	 * @tparam T The Component type.
+	 */
+	template<typename T>
+	void Write() {
+		writes.Set(GetComponentTypeId<T>());
+		accessDeclared = true;
+		++accessVersion;
+	}
+
+	/**
+	 * Gets the Components an Entity must have.
+	 * @return The required mask.
+	 */
+	const Mask &GetRequired() const noexcept { return required; }
+
+	/**
+	 * Gets the Components an Entity must not have.
+	 * @return The excluded mask.
+	 */
+	const Mask &GetExcluded() const noexcept { return excluded; }
+
+	/**
+	 * Gets the Components that must have been added since the System last ran.
+	 * @return The added mask.
+	 */
+	const Mask &GetAdded() const noexcept { return added; }
+
+	/**
+	 * Gets the Components that must have been changed since the System last ran.
+	 * @return The changed mask.
+	 */
+	const Mask &GetChanged() const noexcept { return changed; }
+
+	/**
+	 * Checks if two Systems may not be updated at the same time, because one writes a Component the other accesses.
+	 * A System that has not declared its Component access conflicts with every System.
+	 * @param other The other System filter.
+	 * @return If the Systems conflict.
+	 */
+	bool Conflicts(const ComponentFilter &other) const;
+
+	/**
+	 * Gets a counter increased each time the declared Component access changes, so schedules built from it know when to rebuild.
+	 * @return The access version.
+	 */
+	std::uint32_t GetAccessVersion() const noexcept { return accessVersion; }
+
 private:
 	Mask required;
 	Mask excluded;
+
+	/// Required Components that must have been added or changed since the System last ran.
+	Mask added;
+	Mask changed;
+
+	/// Components read and written during Update.
+	Mask reads;
+	Mask writes;
+
+	/// If Read or Write has been used, otherwise the System is considered to access everything.
+	bool accessDeclared = false;
+
+	/// Number of Read and Write declarations so far.
+	std::uint32_t accessVersion = 0;
 };
 }
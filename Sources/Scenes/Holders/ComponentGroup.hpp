@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>
+
+#include "Utils/NonCopyable.hpp"
+#include "Utils/TypeInfo.hpp"
+#include "ComponentFilter.hpp"
+
+namespace acid {
+/**
+ * @brief An owning group of Component types. The Entities that have all of them are packed at the front of each owned pool,
+ * in the same order, so the Components of the first GetSize Entities of the pools belong to the same Entity at the same index.
+ * A Component type is owned by one group at most.
+ */
+class ACID_EXPORT ComponentGroup : public NonCopyable {
+	friend class ComponentHolder;
+public:
+	/**
+	 * Gets the mask of the owned Component types.
+	 * @return The Component mask.
+	 */
+	const ComponentFilter::Mask &GetMask() const noexcept { return mask; }
+
+	/**
+	 * Gets the owned Component types.
+	 * @return The Component type IDs.
+	 */
+	const std::vector<TypeId> &GetTypes() const noexcept { return types; }
+
+	/**
+	 * Gets the number of Entities that have all the owned Components, they are the first Entities of each owned pool.
+	 * @return The number of Entities.
+	 */
+	std::size_t GetSize() const noexcept { return size; }
+
+private:
+	ComponentFilter::Mask mask;
+	std::vector<TypeId> types;
+	std::size_t size = 0;
+};
+}
@@ -1,31 +1,155 @@
 #include "ComponentHolder.hpp"
 
 namespace acid {
+ComponentHolder::ComponentHolder(std::pmr::memory_resource *upstream) {
+	SetMemoryResource(upstream);
+}
+
 void ComponentHolder::RemoveAllComponents(Entity::Id id) {
-	if (id < components.size()) {
-		for (auto &component : components[id]) {
-			component.reset();
+	const auto index = Entity::GetIndex(id);
+
+	if (index < componentsMasks.size()) {
+		if (groupedComponents.Intersects(componentsMasks[index])) {
+			LeaveGroups(id, componentsMasks[index]);
 		}
 
-		componentsMasks[id].reset();
+		componentsMasks[index].ForEach([this, id](std::size_t typeId) {
+			pools[typeId]->Remove(id);
+		});
+
+		componentsMasks[index].Clear();
+	}
+}
+
+const ComponentFilter::Mask &ComponentHolder::GetComponentsMask(Entity::Id id) const {
+	static const ComponentFilter::Mask empty;
+	const auto index = Entity::GetIndex(id);
+
+	if (index < componentsMasks.size()) {
+		return componentsMasks[index];
+	}
+
+	return empty;
+}
+
+ComponentPoolBase &ComponentHolder::AssurePool(const Component::RegisteredType &type) {
+	if (type.typeId >= MAX_COMPONENTS) {
+		throw std::runtime_error("Component type ID is out of range");
+	}
+
+	if (type.typeId >= pools.size()) {
+		pools.resize(type.typeId + 1);
 	}
+
+	if (!pools[type.typeId]) {
+		pools[type.typeId] = type.createPool(memory.get());
+		pools[type.typeId]->changeTick = &changeTick;
+	}
+
+	return *pools[type.typeId];
 }
 
-ComponentFilter::Mask ComponentHolder::GetComponentsMask(Entity::Id id) const {
-	if (id < componentsMasks.size()) {
-		return componentsMasks[id];
+void ComponentHolder::MarkAdded(Entity::Id id, const ComponentFilter::Mask &added) {
+	componentsMasks[Entity::GetIndex(id)] |= added;
+
+	if (groupedComponents.Intersects(added)) {
+		EnterGroups(id);
 	}
+}
+
+void ComponentHolder::EnterGroups(Entity::Id id) {
+	const auto &mask = componentsMasks[Entity::GetIndex(id)];
+
+	for (const auto &group : groups) {
+		if (!mask.Contains(group->mask) || IsInGroup(*group, id)) {
+			continue;
+		}
+
+		// The Entity Components are swapped with the first Components after the group.
+		const auto position = static_cast<ComponentPoolBase::Index>(group->size);
+
+		for (const auto &typeId : group->types) {
+			auto &pool = *pools[typeId];
+			pool.Swap(pool.GetIndex(id), position);
+		}
 
-	return {};
+		++group->size;
+	}
+}
+
+void ComponentHolder::LeaveGroups(Entity::Id id, const ComponentFilter::Mask &removed) {
+	for (const auto &group : groups) {
+		if (!group->mask.Intersects(removed) || !IsInGroup(*group, id)) {
+			continue;
+		}
+
+		// The Entity Components are swapped with the last Components of the group, which then shrinks.
+		const auto position = static_cast<ComponentPoolBase::Index>(--group->size);
+
+		for (const auto &typeId : group->types) {
+			auto &pool = *pools[typeId];
+			pool.Swap(pool.GetIndex(id), position);
+		}
+	}
+}
+
+void ComponentHolder::PackGroup(ComponentGroup &group) {
+	// Entities joining the group are swapped with positions already walked, so each Entity is walked once.
+	const auto &pool = *pools[group.types.front()];
+
+	for (std::size_t index = 0; index < pool.GetSize(); ++index) {
+		const auto id = pool.GetEntities()[index];
+
+		if (componentsMasks[Entity::GetIndex(id)].Contains(group.mask)) {
+			EnterGroups(id);
+		}
+	}
+}
+
+bool ComponentHolder::IsInGroup(const ComponentGroup &group, Entity::Id id) const noexcept {
+	const auto pool = GetPool(group.types.front());
+
+	if (!pool) {
+		return false;
+	}
+
+	const auto index = pool->GetIndex(id);
+	return index != ComponentPoolBase::NullIndex && index < group.size;
 }
 
 void ComponentHolder::Resize(std::size_t size) {
-	components.resize(size);
 	componentsMasks.resize(size);
 }
 
 void ComponentHolder::Clear() noexcept {
-	components.clear();
+	pools.clear();
 	componentsMasks.clear();
+
+	// Groups stay declared, for the Components added next.
+	for (auto &group : groups) {
+		group->size = 0;
+	}
+
+	// Pools returned their storage to the slabs, which are all given back at once.
+	memory->release();
+}
+
+void ComponentHolder::SetMemoryResource(std::pmr::memory_resource *upstream) {
+	for (const auto &pool : pools) {
+		if (pool && pool->GetSize() != 0) {
+			throw std::runtime_error("Cannot change the memory resource of Components in use");
+		}
+	}
+
+	pools.clear();
+
+	for (auto &group : groups) {
+		group->size = 0;
+	}
+
+	// Vector growth allocates power of two sizes, pooled up to 1 MiB, larger blocks come straight from upstream.
+	std::pmr::pool_options options;
+	options.largest_required_pool_block = 1 << 20;
+	memory = std::make_unique<std::pmr::unsynchronized_pool_resource>(options, upstream);
 }
 }
@@ -1,16 +1,25 @@
 #pragma once
 
-#include <array>
+#include <atomic>
+#include <memory_resource>
 
 #include "Utils/NonCopyable.hpp"
 #include "Scenes/Component.hpp"
 #include "Scenes/Entity.hpp"
 #include "ComponentFilter.hpp"
+#include "ComponentGroup.hpp"
+#include "ComponentPool.hpp"
 
 namespace acid {
 class ACID_EXPORT ComponentHolder : public NonCopyable {
+	friend class Prefab;
+	friend class Snapshot;
 public:
-	ComponentHolder() = default;
+	/**
+	 * Creates a new Component holder.
+	 * @param upstream The memory resource Component storage slabs are allocated from.
+	 */
+	explicit ComponentHolder(std::pmr::memory_resource *upstream = std::pmr::get_default_resource());
 	~ComponentHolder() = default;
 
 	/**
@@ -21,17 +30,8 @@ public:
 	 */
 	template<typename T>
 	bool HasComponent(Entity::Id id) const {
-		// Is the Entity ID and the Component type ID known.
-		if (id < components.size()) {
-			auto typeId = GetComponentTypeId<T>();
-
-			// Is the Component type ID known
-			if (typeId < components[id].size()) {
-				return components[id][typeId] != nullptr;
-			}
-		}
-
-		return false;
+		auto pool = GetPool<T>();
+		return pool && pool->Has(id);
 	}
 
 	/**
@@ -42,41 +42,104 @@ public:
 	 */
 	template<typename T>
 	T *GetComponent(Entity::Id id) const {
-		if (!HasComponent<T>(id)) {
-			//throw std::runtime_error("Entity does not have requested Component");
-			return nullptr;
-		}
+		auto pool = GetPool<T>();
 
-		auto &component = components[id][GetComponentTypeId<T>()];
-
-		if (!component.get()) {
+		if (!pool) {
 			//throw std::runtime_error("Entity does not have requested Component");
 			return nullptr;
 		}
 
-		return static_cast<T *>(component.get());
+		return pool->Get(id);
 	}
 
 	/**
-	 * Adds the Component to the Entity.
+	 * Adds the Component to the Entity, constructing it in the Component pool.
 	 * @tparam T The Component type.
+	 * @tparam Args The constructor arg types.
 	 * @param id The Entity ID.
-	 * @param component The component.
+	 * @param args The constructor arguments.
+	 * @return The Component.
 	 */
-	template<typename T>
-	void AddComponent(Entity::Id id, std::unique_ptr<T> &&component) {
-		if (id >= components.size()) {
+	template<typename T, typename... Args>
+	T *AddComponent(Entity::Id id, Args &&...args) {
+		const auto index = Entity::GetIndex(id);
+
+		if (index >= componentsMasks.size()) {
 			throw std::runtime_error("Entity ID is out of range");
 		}
 
 		const auto typeId = GetComponentTypeId<T>();
 
-		if (typeId >= components[id].size()) {
+		if (typeId >= MAX_COMPONENTS) {
 			throw std::runtime_error("Component type ID is out of range");
 		}
 
-		components[id][typeId] = std::move(component);
-		componentsMasks[id].set(typeId);
+		auto component = AssurePool<T>().Emplace(id, std::forward<Args>(args)...);
+		componentsMasks[index].Set(typeId);
+
+		// Joining a group moves the Component.
+		if (groupedComponents.Test(typeId)) {
+			EnterGroups(id);
+			return GetPool<T>()->Get(id);
+		}
+
+		return component;
+	}
+
+	/**
+	 * Adds several Components to the Entity, updating its mask once.
+	 * @tparam Ts The Component types.
+	 * @param id The Entity ID.
+	 * @param components The Components, moved or copied into their Component pools.
+	 * @return The Components.
+	 */
+	template<typename... Ts>
+	std::tuple<std::decay_t<Ts> *...> AddComponents(Entity::Id id, Ts &&...components) {
+		const auto index = Entity::GetIndex(id);
+
+		if (index >= componentsMasks.size()) {
+			throw std::runtime_error("Entity ID is out of range");
+		}
+
+		const auto mask = GetMask<std::decay_t<Ts>...>();
+		std::tuple<std::decay_t<Ts> *...> result{AssurePool<std::decay_t<Ts>>().Emplace(id, std::forward<Ts>(components))...};
+		componentsMasks[index] |= mask;
+
+		if (groupedComponents.Intersects(mask)) {
+			EnterGroups(id);
+			return {GetPool<std::decay_t<Ts>>()->Get(id)...};
+		}
+
+		return result;
+	}
+
+	/**
+	 * Adds a copy of several Components to each Entity, growing each Component pool once.
+	 * @tparam Ts The Component types.
+	 * @param ids The Entity IDs.
+	 * @param count The number of Entities.
+	 * @param components The Components copied to each Entity.
+	 */
+	template<typename... Ts>
+	void AddComponents(const Entity::Id *ids, std::size_t count, const Ts &...components) {
+		const auto mask = GetMask<Ts...>();
+
+		(AssurePool<Ts>().Reserve(AssurePool<Ts>().GetSize() + count), ...);
+
+		for (std::size_t i = 0; i < count; ++i) {
+			const auto index = Entity::GetIndex(ids[i]);
+
+			if (index >= componentsMasks.size()) {
+				throw std::runtime_error("Entity ID is out of range");
+			}
+
+			(AssurePool<Ts>().Emplace(ids[i], components), ...);
+			componentsMasks[index] |= mask;
+
+			if (groupedComponents.Intersects(mask)) {
+				EnterGroups(ids[i]);
+			}
+		}
 	}
 
 	/**
@@ -90,11 +153,130 @@ public:
 			return;
 		}
 
-		auto &component = components[id][GetComponentTypeId<T>()];
-		component.reset();
-		componentsMasks[id].reset(GetComponentTypeId<T>());
+		const auto typeId = GetComponentTypeId<T>();
+
+		if (groupedComponents.Test(typeId)) {
+			ComponentFilter::Mask removed;
+			removed.Set(typeId);
+			LeaveGroups(id, removed);
+		}
+
+		GetPool<T>()->Remove(id);
+		componentsMasks[Entity::GetIndex(id)].Reset(typeId);
+	}
+
+	/**
+	 * Declares an owning group of Component types, or gets it if it was declared already.
+	 * The Entities that have all of the Components are packed at the front of each pool, in the same order,
+	 * adding or removing one of the Components then also moves the others. Throws if a type is already owned by another group.
+	 * @tparam Ts The Component types.
+	 * @return The group.
+	 */
+	template<typename... Ts>
+	const ComponentGroup &AddGroup() {
+		static_assert(sizeof...(Ts) != 0, "A group owns at least one Component type.");
+
+		const auto mask = GetMask<Ts...>();
+
+		for (const auto &group : groups) {
+			if (group->mask == mask) {
+				return *group;
+			}
+		}
+
+		if (groupedComponents.Intersects(mask)) {
+			throw std::runtime_error("Component type is already owned by another group");
+		}
+
+		(AssurePool<Ts>(), ...);
+
+		auto &group = *groups.emplace_back(std::make_unique<ComponentGroup>());
+		group.mask = mask;
+		mask.ForEach([&group](std::size_t typeId) {
+			group.types.emplace_back(static_cast<TypeId>(typeId));
+		});
+		groupedComponents |= mask;
+		PackGroup(group);
+		return group;
 	}
 
+	/**
+	 * Gets the group owning all of a set of Component types.
+	 * @tparam Ts The Component types.
+	 * @return The group, or nullptr if no group owns all of the types.
+	 */
+	template<typename... Ts>
+	const ComponentGroup *GetGroup() const {
+		const auto mask = GetMask<Ts...>();
+
+		for (const auto &group : groups) {
+			if (group->mask.Contains(mask)) {
+				return group.get();
+			}
+		}
+
+		return nullptr;
+	}
+
+	/**
+	 * Gets all owning groups.
+	 * @return The groups.
+	 */
+	const std::vector<std::unique_ptr<ComponentGroup>> &GetGroups() const noexcept { return groups; }
+
+	/**
+	 * Gets the pool storing all Components of a type.
+	 * @tparam T The Component type.
+	 * @return The Component pool, or nullptr if no Component of this type has been added yet.
+	 */
+	template<typename T>
+	ComponentPool<T> *GetPool() const {
+		const auto typeId = GetComponentTypeId<T>();
+
+		if (typeId >= pools.size()) {
+			return nullptr;
+		}
+
+		return static_cast<ComponentPool<T> *>(pools[typeId].get());
+	}
+
+	/**
+	 * Gets the pool storing all Components of a type.
+	 * @param typeId The Component type ID.
+	 * @return The Component pool, or nullptr if no Component of this type has been added yet.
+	 */
+	ComponentPoolBase *GetPool(TypeId typeId) const noexcept { return typeId < pools.size() ? pools[typeId].get() : nullptr; }
+
+	/**
+	 * Gets the pools of all Component types.
+	 * @return The Component pools, the index of this array matches the Component type ID, types without Components may have no pool.
+	 */
+	const std::vector<std::unique_ptr<ComponentPoolBase>> &GetPools() const noexcept { return pools; }
+
+	/**
+	 * Marks the Component of the Entity as changed, for changes made outside of typed System iteration.
+	 * @tparam T The Component type.
+	 * @param id The Entity ID.
+	 */
+	template<typename T>
+	void MarkChanged(Entity::Id id) {
+		if (auto pool = GetPool<T>()) {
+			pool->MarkChanged(id);
+		}
+	}
+
+	/**
+	 * Gets the change tick stamped on Components added or changed now, outside of System updates.
+	 * @return The change tick.
+	 */
+	ComponentPoolBase::Tick GetChangeTick() const noexcept { return changeTick.load(std::memory_order_relaxed); }
+
+	/**
+	 * Takes the current change tick for a System update, Components added or changed afterwards get a newer tick.
+	 * @return The change tick of the update.
+	 */
+	ComponentPoolBase::Tick AdvanceChangeTick() noexcept { return changeTick.fetch_add(1, std::memory_order_relaxed); }
+
 	/**
 	 * Removes all Components from the Entity.
 	 * @param id The Entity ID.
@@ -104,31 +286,139 @@ public:
 	/**
 	 * Gets the Component mask for the given Entity.
 	 * @param id The Entity ID.
-	 * @return The Component mask.
+	 * @return The Component mask, empty if the Entity ID is out of range.
+	 */
+	const ComponentFilter::Mask &GetComponentsMask(Entity::Id id) const;
+
+	/**
+	 * Gets the Component masks of all Entities.
+	 * @return The Component masks, the index of this array matches the Entity index.
 	 */
-	ComponentFilter::Mask GetComponentsMask(Entity::Id id) const;
+	const std::vector<ComponentFilter::Mask> &GetComponentsMasks() const noexcept { return componentsMasks; }
 
 	/**
-	 * Resizes the Component array.
-	 * @param size The new size.
+	 * Resizes the Component mask array.
+	 * @param size The new size, in Entity indices.
 	 */
 	void Resize(std::size_t size);
 
 	/**
-	 * Clear all Components.
+	 * Clear all Components, and releases all storage slabs to the upstream memory resource at once.
 	 */
 	void Clear() noexcept;
 
+	/**
+	 * Gets the memory resource Component pools allocate from.
+	 * @return The memory resource.
+	 */
+	std::pmr::memory_resource *GetMemoryResource() const noexcept { return memory.get(); }
+
+	/**
+	 * Sets the memory resource storage slabs are allocated from. Throws if any Entity still has a Component.
+	 * @param upstream The upstream memory resource.
+	 */
+	void SetMemoryResource(std::pmr::memory_resource *upstream);
+
 private:
+	/**
+	 * Gets the mask of a set of Component types.
+	 * @tparam Ts The Component types.
+	 * @return The Component mask.
+	 */
+	template<typename... Ts>
+	static ComponentFilter::Mask GetMask() {
+		ComponentFilter::Mask mask;
+
+		for (const auto &typeId : {GetComponentTypeId<Ts>()...}) {
+			if (typeId >= MAX_COMPONENTS) {
+				throw std::runtime_error("Component type ID is out of range");
+			}
+
+			mask.Set(typeId);
+		}
+
+		return mask;
+	}
+
+	/**
+	 * Gets the pool storing all Components of a type, creating it if needed.
+	 * @tparam T The Component type.
+	 * @return The Component pool.
+	 */
+	template<typename T>
+	ComponentPool<T> &AssurePool() {
+		const auto typeId = GetComponentTypeId<T>();
+
+		if (typeId >= pools.size()) {
+			pools.resize(typeId + 1);
+		}
+
+		if (!pools[typeId]) {
+			pools[typeId] = CreateComponentPool<T>(memory.get());
+			pools[typeId]->changeTick = &changeTick;
+		}
+
+		return *static_cast<ComponentPool<T> *>(pools[typeId].get());
+	}
+
+	/**
+	 * Sets Components as added to the Entity mask, after they were added to their pools directly.
+	 * @param id The Entity ID.
+	 * @param added The mask of the added Components.
+	 */
+	void MarkAdded(Entity::Id id, const ComponentFilter::Mask &added);
+
+	/**
+	 * Moves an Entity into the groups it now has all Components of.
+	 * @param id The Entity ID.
+	 */
+	void EnterGroups(Entity::Id id);
+
+	/**
+	 * Moves an Entity out of the groups owning Components about to be removed from it.
+	 * @param id The Entity ID.
+	 * @param removed The mask of the Components to be removed.
+	 */
+	void LeaveGroups(Entity::Id id, const ComponentFilter::Mask &removed);
+
+	/**
+	 * Moves all Entities that have the Components of a new group into it.
+	 * @param group The group.
+	 */
+	void PackGroup(ComponentGroup &group);
+
+	/**
+	 * Checks if an Entity is packed in a group.
+	 * @param group The group.
+	 * @param id The Entity ID.
+	 * @return If the Entity is in the group.
+	 */
+	bool IsInGroup(const ComponentGroup &group, Entity::Id id) const noexcept;
+
+	/**
+	 * Gets the pool storing all Components of a registered type, creating it if needed.
+	 * @param type The registered Component type.
+	 * @return The Component pool.
+	 */
+	ComponentPoolBase &AssurePool(const Component::RegisteredType &type);
+
+	/// Pooled slabs all Component pools allocate from, released in bulk by Clear.
+	/// Declared first so it outlives the pools.
+	std::unique_ptr<std::pmr::unsynchronized_pool_resource> memory;
+
+	/// List of all Component pools.
 	/// The index of this array matches the Component type ID.
-	using ComponentArray = std::array<std::unique_ptr<Component>, MAX_COMPONENTS>;
+	std::vector<std::unique_ptr<ComponentPoolBase>> pools;
+
+	/// Owning groups, and the mask of all the Component types they own.
+	std::vector<std::unique_ptr<ComponentGroup>> groups;
+	ComponentFilter::Mask groupedComponents;
 
-	/// List of all Components of all Entities.
-	/// The index of this array matches the Entity ID.
-	std::vector<ComponentArray> components;
+	/// Change tick, starting after the tick Systems that never ran are considered to have last run at.
+	std::atomic<ComponentPoolBase::Tick> changeTick = 1;
 
 	/// List of all masks of all Composents of all Entities.
-	/// The index of this array matches the Entity ID.
+	/// The index of this array matches the Entity index.
 	std::vector<ComponentFilter::Mask> componentsMasks;
 };
 }
@@ -0,0 +1,340 @@
+#include "ComponentMask.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace acid {
+ComponentMask::ComponentMask(const ComponentMask &other) :
+	summary(other.summary) {
+	if (other.IsInline()) {
+		word = other.word;
+	} else {
+		const auto count = PopCount(summary);
+		words = new Word[count];
+		std::copy(other.words, other.words + count, words);
+	}
+}
+
+ComponentMask::ComponentMask(ComponentMask &&other) noexcept :
+	summary(other.summary) {
+	if (other.IsInline()) {
+		word = other.word;
+	} else {
+		words = other.words;
+	}
+
+	other.summary = 0;
+	other.word = 0;
+}
+
+ComponentMask::ComponentMask(Word summary, const Word *source) {
+	// Only the blocks left with a bit set are kept.
+	Word kept = 0;
+	std::size_t position = 0;
+
+	for (auto blocks = summary; blocks != 0; blocks &= blocks - 1, ++position) {
+		if (source[position] != 0) {
+			kept |= blocks & ~(blocks - 1);
+		}
+	}
+
+	const auto count = PopCount(kept);
+	Word *data = &word;
+
+	if (count > 1) {
+		words = new Word[count];
+		data = words;
+	}
+
+	position = 0;
+	std::size_t stored = 0;
+
+	for (auto blocks = summary; blocks != 0; blocks &= blocks - 1, ++position) {
+		if (source[position] != 0) {
+			data[stored++] = source[position];
+		}
+	}
+
+	this->summary = kept;
+}
+
+ComponentMask::~ComponentMask() {
+	if (!IsInline()) {
+		delete[] words;
+	}
+}
+
+ComponentMask &ComponentMask::operator=(const ComponentMask &other) {
+	if (this != &other) {
+		*this = ComponentMask(other);
+	}
+
+	return *this;
+}
+
+ComponentMask &ComponentMask::operator=(ComponentMask &&other) noexcept {
+	if (this != &other) {
+		Clear();
+		summary = other.summary;
+
+		if (other.IsInline()) {
+			word = other.word;
+		} else {
+			words = other.words;
+		}
+
+		other.summary = 0;
+		other.word = 0;
+	}
+
+	return *this;
+}
+
+bool ComponentMask::Test(std::size_t bit) const noexcept {
+	const auto block = bit / WordBits;
+
+	if (block >= WordBits || (summary & (Word(1) << block)) == 0) {
+		return false;
+	}
+
+	return (GetWords()[GetPosition(block)] >> (bit % WordBits)) & 1;
+}
+
+void ComponentMask::Set(std::size_t bit) {
+	if (bit >= MaxBits) {
+		throw std::out_of_range("Component mask bit is out of range");
+	}
+
+	const auto block = bit / WordBits;
+	const auto blockBit = Word(1) << block;
+	const auto value = Word(1) << (bit % WordBits);
+	const auto position = GetPosition(block);
+
+	if (summary & blockBit) {
+		GetWords()[position] |= value;
+		return;
+	}
+
+	const auto count = PopCount(summary);
+
+	if (count == 0) {
+		summary = blockBit;
+		word = value;
+		return;
+	}
+
+	// Blocks are only added when the first Component of a new range of type IDs is set, the array is reallocated.
+	auto data = new Word[count + 1];
+	const auto old = GetWords();
+	std::copy(old, old + position, data);
+	data[position] = value;
+	std::copy(old + position, old + count, data + position + 1);
+
+	if (!IsInline()) {
+		delete[] words;
+	}
+
+	summary |= blockBit;
+	words = data;
+}
+
+void ComponentMask::Reset(std::size_t bit) noexcept {
+	const auto block = bit / WordBits;
+	const auto blockBit = Word(1) << (block % WordBits);
+
+	if (block >= WordBits || (summary & blockBit) == 0) {
+		return;
+	}
+
+	const auto position = GetPosition(block);
+	auto data = GetWords();
+	data[position] &= ~(Word(1) << (bit % WordBits));
+
+	if (data[position] != 0) {
+		return;
+	}
+
+	// The block is empty, it is removed.
+	const auto count = PopCount(summary);
+
+	if (count == 1) {
+		summary = 0;
+		word = 0;
+	} else if (count == 2) {
+		const auto remaining = data[1 - position];
+		delete[] words;
+		summary &= ~blockBit;
+		word = remaining;
+	} else {
+		std::copy(data + position + 1, data + count, data + position);
+		summary &= ~blockBit;
+	}
+}
+
+void ComponentMask::Clear() noexcept {
+	if (!IsInline()) {
+		delete[] words;
+	}
+
+	summary = 0;
+	word = 0;
+}
+
+std::size_t ComponentMask::Count() const noexcept {
+	const auto data = GetWords();
+	const auto count = PopCount(summary);
+	std::size_t result = 0;
+
+	for (std::size_t i = 0; i < count; ++i) {
+		result += PopCount(data[i]);
+	}
+
+	return result;
+}
+
+bool ComponentMask::Contains(const ComponentMask &other) const noexcept {
+	if (other.summary & ~summary) {
+		return false;
+	}
+
+	const auto data = GetWords();
+	const auto otherData = other.GetWords();
+	std::size_t position = 0;
+
+	for (auto blocks = other.summary; blocks != 0; blocks &= blocks - 1, ++position) {
+		const auto bits = otherData[position];
+
+		if ((data[GetPosition(CountTrailingZeros(blocks))] & bits) != bits) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool ComponentMask::Intersects(const ComponentMask &other) const noexcept {
+	const auto data = GetWords();
+	const auto otherData = other.GetWords();
+
+	for (auto blocks = summary & other.summary; blocks != 0; blocks &= blocks - 1) {
+		const auto block = CountTrailingZeros(blocks);
+
+		if (data[GetPosition(block)] & otherData[other.GetPosition(block)]) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void ComponentMask::Match(const ComponentMask *masks, std::size_t count, const ComponentMask &required, const ComponentMask &excluded,
+	std::uint8_t *results) noexcept {
+	// Blocks of both masks by block index, so single block masks look up theirs without searching.
+	Word requiredBlocks[WordBits] = {};
+	Word excludedBlocks[WordBits] = {};
+	const auto scatter = [](const ComponentMask &mask, Word *blocks) {
+		const auto data = mask.GetWords();
+		std::size_t position = 0;
+
+		for (auto summary = mask.summary; summary != 0; summary &= summary - 1, ++position) {
+			blocks[CountTrailingZeros(summary)] = data[position];
+		}
+	};
+	scatter(required, requiredBlocks);
+	scatter(excluded, excludedBlocks);
+
+	for (std::size_t i = 0; i < count; ++i) {
+		const auto &mask = masks[i];
+
+		if (!mask.IsInline()) {
+			results[i] = mask.Contains(required) && !mask.Intersects(excluded);
+			continue;
+		}
+
+		// An empty mask has an empty block 0, only an empty required mask matches it.
+		const auto block = mask.summary != 0 ? CountTrailingZeros(mask.summary) : 0;
+		results[i] = ((required.summary & ~mask.summary) == 0) & ((requiredBlocks[block] & ~mask.word) == 0) &
+			((excludedBlocks[block] & mask.word) == 0);
+	}
+}
+
+std::size_t ComponentMask::Hash() const noexcept {
+	const auto data = GetWords();
+	const auto count = PopCount(summary);
+	std::size_t hash = std::hash<Word>()(summary);
+
+	for (std::size_t i = 0; i < count; ++i) {
+		hash ^= std::hash<Word>()(data[i]) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+	}
+
+	return hash;
+}
+
+ComponentMask ComponentMask::operator|(const ComponentMask &other) const {
+	return Combine(other, summary | other.summary, [](Word a, Word b) {
+		return a | b;
+	});
+}
+
+ComponentMask ComponentMask::operator&(const ComponentMask &other) const {
+	return Combine(other, summary & other.summary, [](Word a, Word b) {
+		return a & b;
+	});
+}
+
+ComponentMask ComponentMask::operator^(const ComponentMask &other) const {
+	return Combine(other, summary | other.summary, [](Word a, Word b) {
+		return a ^ b;
+	});
+}
+
+ComponentMask &ComponentMask::operator|=(const ComponentMask &other) {
+	// Setting bits within blocks already present needs no allocation.
+	if ((other.summary & ~summary) == 0) {
+		const auto data = GetWords();
+		const auto otherData = other.GetWords();
+		std::size_t position = 0;
+
+		for (auto blocks = other.summary; blocks != 0; blocks &= blocks - 1, ++position) {
+			data[GetPosition(CountTrailingZeros(blocks))] |= otherData[position];
+		}
+
+		return *this;
+	}
+
+	return *this = *this | other;
+}
+
+ComponentMask ComponentMask::operator~() const {
+	return Combine(*this, ~Word(0), [](Word a, Word) {
+		return ~a;
+	});
+}
+
+bool ComponentMask::operator==(const ComponentMask &other) const noexcept {
+	if (summary != other.summary) {
+		return false;
+	}
+
+	const auto data = GetWords();
+	return std::equal(data, data + PopCount(summary), other.GetWords());
+}
+
+template<typename Op>
+ComponentMask ComponentMask::Combine(const ComponentMask &other, Word blocks, Op &&op) const {
+	const auto data = GetWords();
+	const auto otherData = other.GetWords();
+	Word result[WordBits];
+	std::size_t position = 0;
+
+	for (auto remaining = blocks; remaining != 0; remaining &= remaining - 1, ++position) {
+		const auto block = CountTrailingZeros(remaining);
+		const auto blockBit = Word(1) << block;
+		const auto a = (summary & blockBit) ? data[GetPosition(block)] : 0;
+		const auto b = (other.summary & blockBit) ? otherData[other.GetPosition(block)] : 0;
+		result[position] = op(a, b);
+	}
+
+	return ComponentMask(blocks, result);
+}
+}
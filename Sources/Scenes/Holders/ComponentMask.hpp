@@ -0,0 +1,218 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "Export.hpp"
+
+namespace acid {
+/**
+ * @brief A set of Component type IDs stored as a two level bitset. A summary word marks which 64 bit blocks have a bit set,
+ * and only those blocks are stored, in order. Masks with a single non empty block keep it inline without allocating,
+ * so the memory cost and the cost of comparisons scale with the Components in the mask and not with the number of Component types.
+ */
+class ACID_EXPORT ComponentMask {
+public:
+	using Word = std::uint64_t;
+
+	/// Number of bits in a block.
+	static constexpr std::size_t WordBits = 64;
+
+	/// Number of bits a mask can hold, one block per summary bit.
+	static constexpr std::size_t MaxBits = WordBits * WordBits;
+
+	ComponentMask() noexcept = default;
+	ComponentMask(const ComponentMask &other);
+	ComponentMask(ComponentMask &&other) noexcept;
+	~ComponentMask();
+
+	ComponentMask &operator=(const ComponentMask &other);
+	ComponentMask &operator=(ComponentMask &&other) noexcept;
+
+	/**
+	 * Gets if a bit is set.
+	 * @param bit The bit.
+	 * @return If the bit is set.
+	 */
+	bool Test(std::size_t bit) const noexcept;
+
+	/**
+	 * Sets a bit.
+	 * @param bit The bit, throws if it is not less than MaxBits.
+	 */
+	void Set(std::size_t bit);
+
+	/**
+	 * Clears a bit.
+	 * @param bit The bit.
+	 */
+	void Reset(std::size_t bit) noexcept;
+
+	/**
+	 * Clears all bits.
+	 */
+	void Clear() noexcept;
+
+	/**
+	 * Gets if any bit is set.
+	 * @return If any bit is set.
+	 */
+	bool Any() const noexcept { return summary != 0; }
+
+	/**
+	 * Gets if no bit is set.
+	 * @return If no bit is set.
+	 */
+	bool None() const noexcept { return summary == 0; }
+
+	/**
+	 * Gets the number of bits set.
+	 * @return The number of bits set.
+	 */
+	std::size_t Count() const noexcept;
+
+	/**
+	 * Gets the memory allocated for the blocks, none while there is at most one.
+	 * @return The allocated size in bytes.
+	 */
+	std::size_t GetHeapSize() const noexcept { return IsInline() ? 0 : PopCount(summary) * sizeof(Word); }
+
+	/**
+	 * Checks if all bits of another mask are set in this mask.
+	 * @param other The other mask.
+	 * @return If this mask contains the other.
+	 */
+	bool Contains(const ComponentMask &other) const noexcept;
+
+	/**
+	 * Checks if this mask and another share a bit.
+	 * @param other The other mask.
+	 * @return If the masks intersect.
+	 */
+	bool Intersects(const ComponentMask &other) const noexcept;
+
+	/**
+	 * Checks a range of masks, each must contain the required mask and not intersect the excluded mask.
+	 * Masks with a single block are checked word-parallel against per block tables of both masks, without branching on their content.
+	 * @param masks The masks.
+	 * @param count The number of masks.
+	 * @param required The bits each mask must have.
+	 * @param excluded The bits each mask must not have.
+	 * @param results Set to 1 for each mask that matches, 0 otherwise.
+	 */
+	static void Match(const ComponentMask *masks, std::size_t count, const ComponentMask &required, const ComponentMask &excluded,
+		std::uint8_t *results) noexcept;
+
+	/**
+	 * Calls a function with each bit set, in increasing order.
+	 * @tparam Func The function type.
+	 * @param func The function, called with the bit.
+	 */
+	template<typename Func>
+	void ForEach(Func &&func) const {
+		const auto data = GetWords();
+		std::size_t position = 0;
+
+		for (auto blocks = summary; blocks != 0; blocks &= blocks - 1, ++position) {
+			const auto block = CountTrailingZeros(blocks);
+
+			for (auto bits = data[position]; bits != 0; bits &= bits - 1) {
+				func(block * WordBits + CountTrailingZeros(bits));
+			}
+		}
+	}
+
+	/**
+	 * Gets a hash of the bits set.
+	 * @return The hash.
+	 */
+	std::size_t Hash() const noexcept;
+
+	ComponentMask operator|(const ComponentMask &other) const;
+	ComponentMask operator&(const ComponentMask &other) const;
+	ComponentMask operator^(const ComponentMask &other) const;
+	ComponentMask &operator|=(const ComponentMask &other);
+
+	/**
+	 * Gets the mask of all bits below MaxBits that are not set in this mask.
+	 * @return The complement.
+	 */
+	ComponentMask operator~() const;
+
+	bool operator==(const ComponentMask &other) const noexcept;
+	bool operator!=(const ComponentMask &other) const noexcept { return !(*this == other); }
+
+private:
+	/**
+	 * Creates a mask from a summary and its blocks, blocks left empty by an operation are dropped.
+	 * @param summary The blocks present in the words.
+	 * @param words The blocks, one per summary bit in order.
+	 */
+	ComponentMask(Word summary, const Word *words);
+
+	/// The blocks, stored inline while there is at most one.
+	const Word *GetWords() const noexcept { return IsInline() ? &word : words; }
+	Word *GetWords() noexcept { return IsInline() ? &word : words; }
+
+	bool IsInline() const noexcept { return (summary & (summary - 1)) == 0; }
+
+	/**
+	 * Gets the position of a block in the stored blocks.
+	 * @param block The block index.
+	 * @return The number of stored blocks before it.
+	 */
+	std::size_t GetPosition(std::size_t block) const noexcept { return PopCount(summary & ((Word(1) << block) - 1)); }
+
+	/**
+	 * Applies a bitwise operation to the blocks of two masks.
+	 * @tparam Op The operation type.
+	 * @param other The other mask.
+	 * @param blocks The blocks the operation may leave non empty.
+	 * @param op The operation, called with the blocks of both masks.
+	 * @return The result mask.
+	 */
+	template<typename Op>
+	ComponentMask Combine(const ComponentMask &other, Word blocks, Op &&op) const;
+
+	static std::size_t PopCount(Word value) noexcept {
+#if defined(_MSC_VER)
+		return static_cast<std::size_t>(__popcnt64(value));
+#else
+		return static_cast<std::size_t>(__builtin_popcountll(value));
+#endif
+	}
+
+	/// Index of the lowest bit set, value must not be 0.
+	static std::size_t CountTrailingZeros(Word value) noexcept {
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward64(&index, value);
+		return static_cast<std::size_t>(index);
+#else
+		return static_cast<std::size_t>(__builtin_ctzll(value));
+#endif
+	}
+
+	/// Bit i is set if the block of bits [i * 64, i * 64 + 64) is not empty.
+	Word summary = 0;
+
+	/// The only block when there is at most one, otherwise an array of one block per summary bit.
+	union {
+		Word word = 0;
+		Word *words;
+	};
+};
+}
+
+namespace std {
+template<>
+struct hash<acid::ComponentMask> {
+	size_t operator()(const acid::ComponentMask &mask) const noexcept {
+		return mask.Hash();
+	}
+};
+}
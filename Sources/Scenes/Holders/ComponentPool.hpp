@@ -0,0 +1,442 @@
+#pragma once
+
+#include <atomic>
+#include <cstring>
+#include <limits>
+#include <memory_resource>
+#include <stdexcept>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+#include "Utils/MemoryUsage.hpp"
+#include "Utils/NonCopyable.hpp"
+#include "Utils/TypeName.hpp"
+#include "Scenes/Entity.hpp"
+#include "SparseArray.hpp"
+
+namespace acid {
+/**
+ * @brief Type-erased base of a Component pool. A sparse set that maps Entity IDs to indices into a densely packed array,
+ * the sparse side is paged so the memory cost scales with the Entities that own the Component type.
+ */
+class ACID_EXPORT ComponentPoolBase : public NonCopyable {
+	friend class ComponentHolder;
+public:
+	/// Index into the dense arrays.
+	using Index = std::uint32_t;
+
+	/// Change tick, 64 bit so it never wraps around.
+	using Tick = std::uint64_t;
+
+	/// Value stored in the sparse pages for Entities without the Component.
+	static constexpr Index NullIndex = std::numeric_limits<Index>::max();
+
+	/**
+	 * Creates a new Component pool.
+	 * @param resource The memory resource the pool storage is allocated from.
+	 */
+	explicit ComponentPoolBase(std::pmr::memory_resource *resource) :
+		sparse(NullIndex, resource),
+		entities(resource),
+		addedTicks(resource),
+		changedTicks(resource) {
+	}
+
+	virtual ~ComponentPoolBase() = default;
+
+	/**
+	 * Checks whether the Entity has a Component in this pool.
+	 * @param id The Entity ID.
+	 * @return If the Entity has the Component.
+	 */
+	bool Has(Entity::Id id) const noexcept { return GetIndex(id) != NullIndex; }
+
+	/**
+	 * Gets the dense index of the Entity Component.
+	 * @param id The Entity ID.
+	 * @return The dense index, or NullIndex if the Entity has no Component in this pool.
+	 */
+	Index GetIndex(Entity::Id id) const noexcept {
+		const auto index = sparse.Get(Entity::GetIndex(id));
+
+		// A stale Entity ID shares its slot with a newer version of the Entity.
+		if (index == NullIndex || entities[index] != id) {
+			return NullIndex;
+		}
+
+		return index;
+	}
+
+	/**
+	 * Removes the Entity Component from this pool, if it has one.
+	 * @param id The Entity ID.
+	 */
+	virtual void Remove(Entity::Id id) = 0;
+
+	/**
+	 * Removes all Components from this pool.
+	 */
+	virtual void Clear() = 0;
+
+	/**
+	 * Swaps the positions of two Components in the dense arrays.
+	 * @param first The dense index of the first Component.
+	 * @param second The dense index of the second Component.
+	 */
+	virtual void Swap(Index first, Index second) = 0;
+
+	/**
+	 * Gets the number of Components in this pool.
+	 * @return The number of Components.
+	 */
+	std::size_t GetSize() const noexcept { return entities.size(); }
+
+	/**
+	 * Gets the Entities that own a Component in this pool, in the same order as the Components.
+	 * @return The Entity IDs.
+	 */
+	const std::pmr::vector<Entity::Id> &GetEntities() const noexcept { return entities; }
+
+	/**
+	 * Gets the tick the Component was added at.
+	 * @param index The dense index of the Component.
+	 * @return The change tick.
+	 */
+	Tick GetAddedTick(Index index) const noexcept { return addedTicks[index]; }
+
+	/**
+	 * Gets the tick the Component was last changed at, adding a Component changes it.
+	 * @param index The dense index of the Component.
+	 * @return The change tick.
+	 */
+	Tick GetChangedTick(Index index) const noexcept { return changedTicks[index]; }
+
+	/**
+	 * Gets the ticks the Components were added at, in the same order as GetEntities.
+	 * @return The change ticks.
+	 */
+	const Tick *GetAddedTicks() const noexcept { return addedTicks.data(); }
+
+	/**
+	 * Gets the ticks the Components were last changed at, in the same order as GetEntities.
+	 * @return The change ticks.
+	 */
+	const Tick *GetChangedTicks() const noexcept { return changedTicks.data(); }
+
+	/**
+	 * Sets the tick the Component was last changed at.
+	 * @param index The dense index of the Component.
+	 * @param tick The change tick.
+	 */
+	void SetChangedTick(Index index, Tick tick) noexcept { changedTicks[index] = tick; }
+
+	/**
+	 * Marks the Entity Component as changed at the current change tick, if it has one.
+	 * @param id The Entity ID.
+	 */
+	void MarkChanged(Entity::Id id) noexcept {
+		if (const auto index = GetIndex(id); index != NullIndex) {
+			changedTicks[index] = GetChangeTick();
+		}
+	}
+
+	/**
+	 * Gets the memory of the Components, their Entity IDs and change ticks, and the sparse pages.
+	 * @return The memory usage, not counting memory owned by the Components themselves.
+	 */
+	virtual MemoryUsage GetMemoryUsage() const noexcept = 0;
+
+	/**
+	 * Gets the name of the Component type.
+	 * @return The type name, demangled where the compiler mangles it.
+	 */
+	virtual const char *GetTypeName() const = 0;
+
+	/**
+	 * Gets how the Components of this pool are stored in Scene snapshots.
+	 * @return The snapshot format.
+	 */
+	virtual SnapshotFormat GetSnapshotFormat() const noexcept = 0;
+
+	/**
+	 * Gets the size of the plain snapshot record of a Component.
+	 * @return The record size in bytes, 0 unless the snapshot format is Plain.
+	 */
+	virtual std::size_t GetSnapshotStride() const noexcept = 0;
+
+	/**
+	 * Copies the plain snapshot records of a range of Components.
+	 * @param begin The index of the first Component.
+	 * @param count The number of Components.
+	 * @param records The records, GetSnapshotStride bytes each.
+	 */
+	virtual void SaveSnapshot(std::size_t begin, std::size_t count, void *records) const = 0;
+
+	/**
+	 * Writes a Component to a snapshot stream.
+	 * @param index The index of the Component.
+	 * @param stream The stream.
+	 */
+	virtual void SaveSnapshot(std::size_t index, std::ostream &stream) const = 0;
+
+	/**
+	 * Loads the Component of the Entity from a plain snapshot record, default constructing it first if the Entity has none.
+	 * @param id The Entity ID.
+	 * @param record The record, it does not need to be aligned.
+	 */
+	virtual void LoadSnapshot(Entity::Id id, const void *record) = 0;
+
+	/**
+	 * Loads the Components of several Entities from the same plain snapshot record, growing the pool once.
+	 * @param ids The Entity IDs.
+	 * @param count The number of Entities.
+	 * @param record The record, it does not need to be aligned.
+	 */
+	virtual void LoadSnapshot(const Entity::Id *ids, std::size_t count, const void *record) = 0;
+
+	/**
+	 * Loads the Component of the Entity from a snapshot stream, default constructing it first if the Entity has none.
+	 * @param id The Entity ID.
+	 * @param stream The stream.
+	 */
+	virtual void LoadSnapshot(Entity::Id id, std::istream &stream) = 0;
+
+protected:
+	/**
+	 * Gets the change tick stamped on Components added or changed now.
+	 * @return The change tick.
+	 */
+	Tick GetChangeTick() const noexcept { return changeTick ? changeTick->load(std::memory_order_relaxed) : 0; }
+
+	/// Sparse indices into the dense arrays, the index of this array matches the Entity index.
+	SparseArray<Index> sparse;
+
+	/// Dense list of Entity IDs, the index of this array matches the Component index.
+	std::pmr::vector<Entity::Id> entities;
+
+	/// Dense lists of the ticks Components were added and last changed at, the index of these arrays matches the Component index.
+	std::pmr::vector<Tick> addedTicks;
+	std::pmr::vector<Tick> changedTicks;
+
+	/// The change tick of the Component holder that owns this pool.
+	const std::atomic<Tick> *changeTick = nullptr;
+};
+
+/**
+ * @brief Contiguous storage of all Components of the type T.
+ * Pointers to Components are invalidated when a Component of the same type is added or removed,
+ * or of any type owned by the same group.
+ * @tparam T The Component type.
+ */
+template<typename T>
+class ComponentPool : public ComponentPoolBase {
+public:
+	/**
+	 * Creates a new Component pool.
+	 * @param resource The memory resource the Components are allocated from.
+	 */
+	explicit ComponentPool(std::pmr::memory_resource *resource) :
+		ComponentPoolBase(resource),
+		components(resource) {
+	}
+
+	/**
+	 * Gets the Component of the Entity.
+	 * @param id The Entity ID.
+	 * @return The Component, or nullptr if the Entity does not have one.
+	 */
+	T *Get(Entity::Id id) noexcept {
+		const auto index = GetIndex(id);
+		return index != NullIndex ? &components[index] : nullptr;
+	}
+
+	/**
+	 * Constructs the Component of the Entity in place, replacing any previous one.
+	 * A Component left behind by an older Entity with the same index is taken over as a new one.
+	 * @tparam Args The constructor arg types.
+	 * @param id The Entity ID.
+	 * @param args The constructor arguments.
+	 * @return The Component.
+	 */
+	template<typename... Args>
+	T *Emplace(Entity::Id id, Args &&...args) {
+		auto &index = sparse.Assure(Entity::GetIndex(id));
+
+		const auto tick = GetChangeTick();
+
+		if (index != NullIndex) {
+			components[index] = T(std::forward<Args>(args)...);
+			changedTicks[index] = tick;
+
+			if (entities[index] != id) {
+				entities[index] = id;
+				addedTicks[index] = tick;
+			}
+
+			return &components[index];
+		}
+
+		components.emplace_back(std::forward<Args>(args)...);
+		entities.emplace_back(id);
+		addedTicks.emplace_back(tick);
+		changedTicks.emplace_back(tick);
+		index = static_cast<Index>(components.size() - 1);
+		return &components.back();
+	}
+
+	/**
+	 * Reserves storage for a number of Components.
+	 * @param capacity The number of Components.
+	 */
+	void Reserve(std::size_t capacity) {
+		components.reserve(capacity);
+		entities.reserve(capacity);
+		addedTicks.reserve(capacity);
+		changedTicks.reserve(capacity);
+	}
+
+	void Remove(Entity::Id id) override {
+		const auto index = GetIndex(id);
+
+		if (index == NullIndex) {
+			return;
+		}
+
+		// Moves the last Component into the removed slot to keep the array packed.
+		const auto last = entities.back();
+
+		if (last != id) {
+			components[index] = std::move(components.back());
+			entities[index] = last;
+			addedTicks[index] = addedTicks.back();
+			changedTicks[index] = changedTicks.back();
+			sparse.Assure(Entity::GetIndex(last)) = index;
+		}
+
+		components.pop_back();
+		entities.pop_back();
+		addedTicks.pop_back();
+		changedTicks.pop_back();
+		sparse.Assure(Entity::GetIndex(id)) = NullIndex;
+	}
+
+	void Swap(Index first, Index second) override {
+		if (first == second) {
+			return;
+		}
+
+		std::swap(components[first], components[second]);
+		std::swap(entities[first], entities[second]);
+		std::swap(addedTicks[first], addedTicks[second]);
+		std::swap(changedTicks[first], changedTicks[second]);
+		sparse.Assure(Entity::GetIndex(entities[first])) = first;
+		sparse.Assure(Entity::GetIndex(entities[second])) = second;
+	}
+
+	void Clear() override {
+		components.clear();
+		entities.clear();
+		addedTicks.clear();
+		changedTicks.clear();
+		sparse.Clear();
+	}
+
+	MemoryUsage GetMemoryUsage() const noexcept override {
+		auto usage = sparse.GetMemoryUsage();
+		usage += MemoryUsage::Of(components);
+		usage += MemoryUsage::Of(entities);
+		usage += MemoryUsage::Of(addedTicks);
+		usage += MemoryUsage::Of(changedTicks);
+		return usage;
+	}
+
+	const char *GetTypeName() const override { return acid::GetTypeName(typeid(T)); }
+
+	SnapshotFormat GetSnapshotFormat() const noexcept override { return acid::GetSnapshotFormat<T>(); }
+
+	std::size_t GetSnapshotStride() const noexcept override { return acid::GetSnapshotStride<T>(); }
+
+	void SaveSnapshot(std::size_t begin, std::size_t count, void *records) const override {
+		if constexpr (acid::GetSnapshotFormat<T>() == SnapshotFormat::Plain) {
+			auto bytes = static_cast<unsigned char *>(records);
+
+			for (std::size_t i = 0; i < count; ++i) {
+				const auto data = components[begin + i].GetSnapshotData();
+				std::memcpy(bytes + i * sizeof(data), &data, sizeof(data));
+			}
+		} else {
+			throw std::runtime_error("Component type has no plain snapshot record");
+		}
+	}
+
+	void SaveSnapshot(std::size_t index, std::ostream &stream) const override {
+		if constexpr (acid::GetSnapshotFormat<T>() == SnapshotFormat::Stream) {
+			components[index].WriteSnapshot(stream);
+		} else {
+			throw std::runtime_error("Component type is not streamed in snapshots");
+		}
+	}
+
+	void LoadSnapshot(Entity::Id id, const void *record) override {
+		if constexpr (acid::GetSnapshotFormat<T>() == SnapshotFormat::Plain) {
+			typename T::SnapshotData data;
+			std::memcpy(&data, record, sizeof(data));
+			Assure(id).SetSnapshotData(data);
+		} else {
+			throw std::runtime_error("Component type has no plain snapshot record");
+		}
+	}
+
+	void LoadSnapshot(const Entity::Id *ids, std::size_t count, const void *record) override {
+		if constexpr (acid::GetSnapshotFormat<T>() == SnapshotFormat::Plain) {
+			typename T::SnapshotData data;
+			std::memcpy(&data, record, sizeof(data));
+			Reserve(GetSize() + count);
+
+			for (std::size_t i = 0; i < count; ++i) {
+				Assure(ids[i]).SetSnapshotData(data);
+			}
+		} else {
+			throw std::runtime_error("Component type has no plain snapshot record");
+		}
+	}
+
+	void LoadSnapshot(Entity::Id id, std::istream &stream) override {
+		if constexpr (acid::GetSnapshotFormat<T>() == SnapshotFormat::Stream) {
+			Assure(id).ReadSnapshot(stream);
+		} else {
+			throw std::runtime_error("Component type is not streamed in snapshots");
+		}
+	}
+
+	/**
+	 * Gets the packed Components, in the same order as GetEntities.
+	 * @return The Components.
+	 */
+	T *GetData() noexcept { return components.data(); }
+
+private:
+	/**
+	 * Gets the Component of the Entity to be changed, default constructing it if the Entity has none.
+	 * @param id The Entity ID.
+	 * @return The Component.
+	 */
+	T &Assure(Entity::Id id) {
+		if (const auto index = GetIndex(id); index != NullIndex) {
+			changedTicks[index] = GetChangeTick();
+			return components[index];
+		}
+
+		return *Emplace(id);
+	}
+
+	/// Dense list of Components.
+	std::pmr::vector<T> components;
+};
+
+template<typename T>
+std::unique_ptr<ComponentPoolBase> CreateComponentPool(std::pmr::memory_resource *resource) {
+	return std::make_unique<ComponentPool<T>>(resource);
+}
+}
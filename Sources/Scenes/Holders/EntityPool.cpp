@@ -1,12 +1,14 @@
 #include "EntityPool.hpp"
 
+#include <algorithm>
+
 namespace acid {
 Entity::Id EntityPool::Create() {
 	Entity::Id id;
 
 	if (storedIds.empty()) {
-		id = nextId;
-		++nextId;
+		id = Entity::MakeId(nextIndex, 0);
+		++nextIndex;
 	} else {
 		id = storedIds.back();
 		storedIds.pop_back();
@@ -16,14 +18,22 @@ Entity::Id EntityPool::Create() {
 }
 
 void EntityPool::Store(Entity::Id id) {
-	if (id < nextId) {
+	const auto index = Entity::GetIndex(id);
+
+	if (index < nextIndex) {
 		// Cannot store an ID that haven't been generated before.
-		storedIds.emplace_back(id);
+		storedIds.emplace_back(Entity::MakeId(index, Entity::GetVersion(id) + 1));
 	}
 }
 
-void EntityPool::Reset() noexcept {
-	storedIds.clear();
-	nextId = 0;
+void EntityPool::Reset(const std::vector<Entity::Id> &liveIds) {
+	for (const auto id : liveIds) {
+		Store(id);
+	}
+
+	// IDs are recycled from the back, so the lowest indices come first.
+	std::sort(storedIds.begin(), storedIds.end(), [](Entity::Id lhs, Entity::Id rhs) {
+		return Entity::GetIndex(lhs) > Entity::GetIndex(rhs);
+	});
 }
 }
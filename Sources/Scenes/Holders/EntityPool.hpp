@@ -1,5 +1,6 @@
 #pragma once
 
+#include "Utils/MemoryUsage.hpp"
 #include "Utils/NonCopyable.hpp"
 #include "Scenes/Entity.hpp"
 
@@ -10,27 +11,35 @@ public:
 	~EntityPool() = default;
 
 	/**
-	 * Creates an Entity ID.
+	 * Creates an Entity ID, recycling the index of a stored ID with its version incremented.
 	 * @return The Entity ID.
 	 */
 	Entity::Id Create();
 
 	/**
-	 * Stores an Entity ID.
+	 * Stores an Entity ID, so its index can be reused by a newer version.
 	 * @param id The Entity ID.
 	 */
 	void Store(Entity::Id id);
 
 	/**
-	 * Removes all Entity IDs stored within the pool and resets the next Entity ID value.
+	 * Makes every generated Entity ID unused again. Versions are kept, so an ID from before the reset is never handed out again,
+	 * and indices are reused from the lowest one.
+	 * @param liveIds The Entity IDs still in use, stored with their version incremented.
 	 */
-	void Reset() noexcept;
+	void Reset(const std::vector<Entity::Id> &liveIds);
+
+	/**
+	 * Gets the memory of the stored Entity IDs.
+	 * @return The memory usage.
+	 */
+	MemoryUsage GetMemoryUsage() const noexcept { return MemoryUsage::Of(storedIds); }
 
 private:
-	/// List of stored Entities IDs that are not in use.
+	/// List of stored Entities IDs that are not in use, already carrying the version their next use will have.
 	std::vector<Entity::Id> storedIds;
 
-	/// The next available Entity ID.
-	Entity::Id nextId = 0;
+	/// The next never used Entity index.
+	Entity::Index nextIndex = 0;
 };
 }
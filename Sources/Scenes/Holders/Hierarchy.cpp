@@ -0,0 +1,275 @@
+#include "Hierarchy.hpp"
+
+#include <stdexcept>
+
+namespace acid {
+void Hierarchy::SetParent(Entity::Id id, Entity::Id parent) {
+	if (parent == GetParent(id)) {
+		return;
+	}
+
+	// The parent must not be in the subtree of the Entity.
+	for (auto ancestor = parent; ancestor != Entity::NullId; ancestor = GetParent(ancestor)) {
+		if (ancestor == id) {
+			throw std::runtime_error("Entity cannot be parented to itself or its descendants");
+		}
+	}
+
+	if (parent == Entity::NullId) {
+		// The Entity has a parent, it becomes a root or leaves the hierarchy.
+		Unlink(id);
+		MarkDirty(id);
+		Release(id);
+		orderDirty = true;
+		return;
+	}
+
+	if (Find(id)) {
+		Unlink(id);
+	}
+
+	// A parent entering the hierarchy was never propagated as a root.
+	if (!Find(parent)) {
+		Assure(parent);
+		MarkDirty(parent);
+	}
+
+	Assure(id);
+
+	auto &node = GetNode(id);
+	auto &parentNode = GetNode(parent);
+	node.parent = parent;
+	node.previousSibling = parentNode.lastChild;
+
+	if (parentNode.lastChild != Entity::NullId) {
+		GetNode(parentNode.lastChild).nextSibling = id;
+	} else {
+		parentNode.firstChild = id;
+	}
+
+	parentNode.lastChild = id;
+	orderDirty = true;
+	MarkDirty(id);
+}
+
+void Hierarchy::Remove(Entity::Id id) {
+	if (!Find(id)) {
+		return;
+	}
+
+	Unlink(id);
+
+	// Children become roots.
+	for (auto child = GetNode(id).firstChild; child != Entity::NullId;) {
+		auto &childNode = GetNode(child);
+		const auto next = childNode.nextSibling;
+		childNode.parent = Entity::NullId;
+		childNode.previousSibling = Entity::NullId;
+		childNode.nextSibling = Entity::NullId;
+		MarkDirty(child);
+		Release(child);
+		child = next;
+	}
+
+	GetNode(id) = Node();
+	orderDirty = true;
+}
+
+std::size_t Hierarchy::GetDepth(Entity::Id id) const noexcept {
+	std::size_t depth = 0;
+
+	for (auto parent = GetParent(id); parent != Entity::NullId; parent = GetParent(parent)) {
+		++depth;
+	}
+
+	return depth;
+}
+
+void Hierarchy::GetDescendants(Entity::Id id, std::vector<Entity::Id> &descendants) const {
+	if (!Find(id)) {
+		return;
+	}
+
+	// Walks the links depth first without a stack, climbing back up through the parents.
+	auto current = nodes[Entity::GetIndex(id)].firstChild;
+
+	while (current != Entity::NullId) {
+		descendants.emplace_back(current);
+		const auto &node = nodes[Entity::GetIndex(current)];
+
+		if (node.firstChild != Entity::NullId) {
+			current = node.firstChild;
+			continue;
+		}
+
+		while (current != id && nodes[Entity::GetIndex(current)].nextSibling == Entity::NullId) {
+			current = nodes[Entity::GetIndex(current)].parent;
+		}
+
+		current = current != id ? nodes[Entity::GetIndex(current)].nextSibling : Entity::NullId;
+	}
+}
+
+void Hierarchy::MarkDirty(Entity::Id id) {
+	if (Find(id)) {
+		dirtyEntities.emplace_back(id);
+	}
+}
+
+const std::vector<Entity::Id> &Hierarchy::GetOrder() {
+	UpdateOrder();
+	return order;
+}
+
+void Hierarchy::Clear() noexcept {
+	nodes.clear();
+	order.clear();
+	parentPositions.clear();
+	dirtyEntities.clear();
+	detachedEntities.clear();
+	dirtyRanges.clear();
+	orderDirty = false;
+}
+
+MemoryUsage Hierarchy::GetMemoryUsage() const noexcept {
+	auto usage = MemoryUsage::Of(nodes);
+	usage += MemoryUsage::Of(order);
+	usage += MemoryUsage::Of(parentPositions);
+	usage += MemoryUsage::Of(dirtyEntities);
+	usage += MemoryUsage::Of(detachedEntities);
+	usage += MemoryUsage::Of(dirtyRanges);
+	return usage;
+}
+
+Hierarchy::Node &Hierarchy::Assure(Entity::Id id) {
+	const auto index = Entity::GetIndex(id);
+
+	if (index >= nodes.size()) {
+		nodes.resize(index + 1);
+	}
+
+	if (nodes[index].id != id) {
+		nodes[index] = Node();
+		nodes[index].id = id;
+	}
+
+	return nodes[index];
+}
+
+void Hierarchy::Unlink(Entity::Id id) {
+	auto &node = GetNode(id);
+
+	if (node.parent == Entity::NullId) {
+		return;
+	}
+
+	auto &parentNode = GetNode(node.parent);
+
+	if (node.previousSibling != Entity::NullId) {
+		GetNode(node.previousSibling).nextSibling = node.nextSibling;
+	} else {
+		parentNode.firstChild = node.nextSibling;
+	}
+
+	if (node.nextSibling != Entity::NullId) {
+		GetNode(node.nextSibling).previousSibling = node.previousSibling;
+	} else {
+		parentNode.lastChild = node.previousSibling;
+	}
+
+	const auto parent = node.parent;
+	node.parent = Entity::NullId;
+	node.previousSibling = Entity::NullId;
+	node.nextSibling = Entity::NullId;
+	Release(parent);
+}
+
+void Hierarchy::Release(Entity::Id id) {
+	auto &node = GetNode(id);
+
+	if (node.parent == Entity::NullId && node.firstChild == Entity::NullId) {
+		node = Node();
+		detachedEntities.emplace_back(id);
+	}
+}
+
+void Hierarchy::UpdateOrder() {
+	if (!orderDirty) {
+		return;
+	}
+
+	order.clear();
+	parentPositions.clear();
+
+	for (const auto &root : nodes) {
+		if (root.id == Entity::NullId || root.parent != Entity::NullId) {
+			continue;
+		}
+
+		// Depth first walk of the root subtree, a subtree size is known when the walk leaves it.
+		auto current = root.id;
+		auto parentPosition = NullPosition;
+
+		for (bool done = false; !done;) {
+			auto &node = GetNode(current);
+			node.position = static_cast<Position>(order.size());
+			order.emplace_back(current);
+			parentPositions.emplace_back(parentPosition);
+
+			if (node.firstChild != Entity::NullId) {
+				parentPosition = node.position;
+				current = node.firstChild;
+				continue;
+			}
+
+			// Leaves the finished subtrees until one has a next sibling, or the root is left.
+			while (true) {
+				auto &leaving = GetNode(current);
+				leaving.size = static_cast<Position>(order.size()) - leaving.position;
+
+				if (current == root.id) {
+					done = true;
+					break;
+				}
+
+				if (leaving.nextSibling != Entity::NullId) {
+					parentPosition = parentPositions[leaving.position];
+					current = leaving.nextSibling;
+					break;
+				}
+
+				current = leaving.parent;
+			}
+		}
+	}
+
+	orderDirty = false;
+}
+
+void Hierarchy::UpdateDirtyRanges() {
+	dirtyRanges.clear();
+
+	for (const auto &id : dirtyEntities) {
+		// Entities may have left the hierarchy since they were marked.
+		if (Find(id)) {
+			const auto &node = GetNode(id);
+			dirtyRanges.emplace_back(node.position, node.position + node.size);
+		}
+	}
+
+	std::sort(dirtyRanges.begin(), dirtyRanges.end());
+
+	// Subtrees are either nested or disjoint, nested ones are dropped.
+	std::size_t count = 0;
+
+	for (const auto &range : dirtyRanges) {
+		if (count != 0 && range.first < dirtyRanges[count - 1].second) {
+			continue;
+		}
+
+		dirtyRanges[count++] = range;
+	}
+
+	dirtyRanges.resize(count);
+}
+}
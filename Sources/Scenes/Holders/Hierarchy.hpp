@@ -0,0 +1,228 @@
+#pragma once
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include "Utils/MemoryUsage.hpp"
+#include "Utils/NonCopyable.hpp"
+#include "Scenes/Entity.hpp"
+
+namespace acid {
+/**
+ * @brief Parent and child relations between Entities, stored as parent, first child and sibling links indexed by Entity index.
+ * Entities with a parent or children are also kept in a depth first order, where each parent comes before its children
+ * and each subtree is a contiguous range, so propagating values down the tree is a linear walk.
+ * Subtrees marked dirty are propagated again, other subtrees are not visited. Entities that left the hierarchy without being
+ * removed are visited once as roots, so their values no longer come from a parent.
+ */
+class ACID_EXPORT Hierarchy : public NonCopyable {
+public:
+	/// Position of an Entity in the depth first order.
+	using Position = std::uint32_t;
+
+	/// Position of the parent of a root.
+	static constexpr Position NullPosition = std::numeric_limits<Position>::max();
+
+	Hierarchy() = default;
+	~Hierarchy() = default;
+
+	/**
+	 * Sets the parent of an Entity, it becomes the last child of the parent. The Entity subtree is marked dirty,
+	 * Entities leaving the hierarchy are marked detached.
+	 * Throws if the parent is the Entity or one of its descendants.
+	 * @param id The Entity ID.
+	 * @param parent The parent Entity ID, NullId removes the Entity from its parent.
+	 */
+	void SetParent(Entity::Id id, Entity::Id parent);
+
+	/**
+	 * Removes an Entity from the hierarchy, its children become roots and are marked dirty, or detached if they leave the hierarchy.
+	 * @param id The Entity ID.
+	 */
+	void Remove(Entity::Id id);
+
+	/**
+	 * Gets the parent of an Entity.
+	 * @param id The Entity ID.
+	 * @return The parent Entity ID, NullId if the Entity has no parent.
+	 */
+	Entity::Id GetParent(Entity::Id id) const noexcept { return Find(id) ? nodes[Entity::GetIndex(id)].parent : Entity::NullId; }
+
+	/**
+	 * Gets the first child of an Entity.
+	 * @param id The Entity ID.
+	 * @return The first child Entity ID, NullId if the Entity has no children.
+	 */
+	Entity::Id GetFirstChild(Entity::Id id) const noexcept { return Find(id) ? nodes[Entity::GetIndex(id)].firstChild : Entity::NullId; }
+
+	/**
+	 * Gets the next child of the parent of an Entity.
+	 * @param id The Entity ID.
+	 * @return The next sibling Entity ID, NullId if the Entity is the last child.
+	 */
+	Entity::Id GetNextSibling(Entity::Id id) const noexcept { return Find(id) ? nodes[Entity::GetIndex(id)].nextSibling : Entity::NullId; }
+
+	/**
+	 * Gets the number of ancestors of an Entity.
+	 * @param id The Entity ID.
+	 * @return The depth, 0 for roots and Entities outside of the hierarchy.
+	 */
+	std::size_t GetDepth(Entity::Id id) const noexcept;
+
+	/**
+	 * Gets the descendants of an Entity, parents before their children.
+	 * @param id The Entity ID.
+	 * @param descendants The descendant Entity IDs are appended to this array.
+	 */
+	void GetDescendants(Entity::Id id, std::vector<Entity::Id> &descendants) const;
+
+	/**
+	 * Marks the subtree of an Entity to be propagated again.
+	 * @param id The Entity ID, ignored if the Entity has no parent and no children.
+	 */
+	void MarkDirty(Entity::Id id);
+
+	/**
+	 * Gets if any subtree is marked dirty or any Entity detached.
+	 * @return If the hierarchy is dirty.
+	 */
+	bool IsDirty() const noexcept { return !dirtyEntities.empty() || !detachedEntities.empty(); }
+
+	/**
+	 * Gets the Entities with a parent or children in depth first order, rebuilding the order if links changed since.
+	 * @return The Entity IDs, the index of this array is the Entity position.
+	 */
+	const std::vector<Entity::Id> &GetOrder();
+
+	/**
+	 * Gets the parent position of each Entity in the depth first order.
+	 * @return The parent positions, NullPosition for roots, the index of this array is the Entity position.
+	 */
+	const std::vector<Position> &GetParentPositions() {
+		UpdateOrder();
+		return parentPositions;
+	}
+
+	/**
+	 * Visits the detached Entities still outside of the hierarchy, then the Entities of the dirty subtrees in depth first order,
+	 * each parent before its children, then clears the detached and dirty marks.
+	 * Positions are those of GetOrder, links must not be changed while propagating.
+	 * @tparam Func The function type.
+	 * @tparam DetachedFunc The detached function type.
+	 * @param func The function, taking the position of the Entity and the position of its parent, or NullPosition for roots.
+	 * @param detachedFunc The detached function, taking the Entity ID, called once per Entity.
+	 */
+	template<typename Func, typename DetachedFunc>
+	void Propagate(Func &&func, DetachedFunc &&detachedFunc) {
+		// An Entity may be detached more than once, or be back in the hierarchy, where it is propagated with its subtree.
+		std::sort(detachedEntities.begin(), detachedEntities.end());
+		detachedEntities.erase(std::unique(detachedEntities.begin(), detachedEntities.end()), detachedEntities.end());
+
+		for (const auto &id : detachedEntities) {
+			if (Find(id)) {
+				dirtyEntities.emplace_back(id);
+			} else {
+				detachedFunc(id);
+			}
+		}
+
+		UpdateOrder();
+		UpdateDirtyRanges();
+
+		for (const auto &[begin, end] : dirtyRanges) {
+			for (auto position = begin; position < end; ++position) {
+				func(position, parentPositions[position]);
+			}
+		}
+
+		detachedEntities.clear();
+		dirtyEntities.clear();
+	}
+
+	/**
+	 * Removes all links.
+	 */
+	void Clear() noexcept;
+
+	/**
+	 * Gets the memory of the links, the depth first order and the dirty and detached marks.
+	 * @return The memory usage.
+	 */
+	MemoryUsage GetMemoryUsage() const noexcept;
+
+private:
+	class Node {
+	public:
+		/// The Entity ID, NullId if the Entity has no parent and no children.
+		Entity::Id id = Entity::NullId;
+		Entity::Id parent = Entity::NullId;
+		Entity::Id firstChild = Entity::NullId;
+		Entity::Id lastChild = Entity::NullId;
+		Entity::Id previousSibling = Entity::NullId;
+		Entity::Id nextSibling = Entity::NullId;
+
+		/// Position in the depth first order and size of the subtree, valid while the order is.
+		Position position = NullPosition;
+		Position size = 0;
+	};
+
+	/**
+	 * Gets if an Entity has a parent or children.
+	 * @param id The Entity ID.
+	 * @return If the Entity is in the hierarchy.
+	 */
+	bool Find(Entity::Id id) const noexcept {
+		const auto index = Entity::GetIndex(id);
+		return index < nodes.size() && nodes[index].id == id;
+	}
+
+	/**
+	 * Gets the node of an Entity, adding it to the hierarchy.
+	 * @param id The Entity ID.
+	 * @return The node.
+	 */
+	Node &Assure(Entity::Id id);
+
+	/**
+	 * Unlinks an Entity from its parent and siblings.
+	 * @param id The Entity ID.
+	 */
+	void Unlink(Entity::Id id);
+
+	/**
+	 * Removes an Entity from the hierarchy if it has no parent and no children left, it is marked detached.
+	 * @param id The Entity ID.
+	 */
+	void Release(Entity::Id id);
+
+	/**
+	 * Rebuilds the depth first order if links changed, roots are ordered by Entity index.
+	 */
+	void UpdateOrder();
+
+	/**
+	 * Converts the dirty Entities into sorted, non overlapping ranges of positions.
+	 */
+	void UpdateDirtyRanges();
+
+	Node &GetNode(Entity::Id id) { return nodes[Entity::GetIndex(id)]; }
+
+	/// Links of all Entities, the index of this array matches the Entity index.
+	std::vector<Node> nodes;
+
+	/// Entities in depth first order, and the position of their parent.
+	std::vector<Entity::Id> order;
+	std::vector<Position> parentPositions;
+	bool orderDirty = false;
+
+	/// Entities whose subtree is propagated next.
+	std::vector<Entity::Id> dirtyEntities;
+
+	/// Entities that left the hierarchy without being removed, propagated next as roots.
+	std::vector<Entity::Id> detachedEntities;
+
+	/// Scratch ranges of positions propagated next.
+	std::vector<std::pair<Position, Position>> dirtyRanges;
+};
+}
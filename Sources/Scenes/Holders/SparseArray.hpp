@@ -0,0 +1,116 @@
+#pragma once
+
+#include <array>
+#include <memory_resource>
+#include <new>
+#include <vector>
+
+#include "Utils/MemoryUsage.hpp"
+#include "Scenes/Entity.hpp"
+
+namespace acid {
+/**
+ * @brief A map from Entity indices to values, stored in lazily allocated pages so the memory cost scales with the range of indices in use.
+ * @tparam T The value type.
+ */
+template<typename T>
+class SparseArray {
+public:
+	/**
+	 * Creates a new sparse array.
+	 * @param null The value of indices that have not been assigned.
+	 * @param resource The memory resource pages are allocated from.
+	 */
+	explicit SparseArray(const T &null = T(), std::pmr::memory_resource *resource = std::pmr::get_default_resource()) :
+		pages(resource),
+		null(null) {
+	}
+
+	~SparseArray() {
+		Clear();
+	}
+
+	SparseArray(const SparseArray &) = delete;
+	SparseArray &operator=(const SparseArray &) = delete;
+
+	/**
+	 * Gets the value of an Entity index.
+	 * @param index The Entity index.
+	 * @return The value, or the null value if the index has not been assigned.
+	 */
+	const T &Get(Entity::Index index) const noexcept {
+		const auto page = index / PageSize;
+
+		if (page >= pages.size() || !pages[page]) {
+			return null;
+		}
+
+		return (*pages[page])[index % PageSize];
+	}
+
+	/**
+	 * Gets a writable reference to the value of an Entity index, allocating its page if needed.
+	 * @param index The Entity index.
+	 * @return The value.
+	 */
+	T &Assure(Entity::Index index) {
+		const auto page = index / PageSize;
+
+		if (page >= pages.size()) {
+			pages.resize(page + 1);
+		}
+
+		if (!pages[page]) {
+			auto allocator = pages.get_allocator();
+			pages[page] = new(allocator.resource()->allocate(sizeof(Page), alignof(Page))) Page;
+			pages[page]->fill(null);
+		}
+
+		return (*pages[page])[index % PageSize];
+	}
+
+	/**
+	 * Gets the memory of the allocated pages and the page table.
+	 * @return The memory usage, allocated pages count as used.
+	 */
+	MemoryUsage GetMemoryUsage() const noexcept {
+		auto usage = MemoryUsage::Of(pages);
+
+		for (const auto &page : pages) {
+			if (page) {
+				usage += {sizeof(Page), sizeof(Page)};
+			}
+		}
+
+		return usage;
+	}
+
+	/**
+	 * Releases all pages.
+	 */
+	void Clear() noexcept {
+		auto resource = pages.get_allocator().resource();
+
+		for (auto &page : pages) {
+			if (page) {
+				page->~Page();
+				resource->deallocate(page, sizeof(Page), alignof(Page));
+			}
+		}
+
+		pages.clear();
+	}
+
+private:
+	/// Number of Entity indices covered by each page.
+	static constexpr std::size_t PageSize = 4096;
+
+	using Page = std::array<T, PageSize>;
+
+	/// Pages, the index of a page entry matches the Entity index.
+	std::pmr::vector<Page *> pages;
+
+	/// The value of indices that have not been assigned.
+	T null;
+};
+}
@@ -1,5 +1,7 @@
 #include "SystemHolder.hpp"
 
+#include <algorithm>
+
 namespace acid {
 SystemHolder::~SystemHolder() {
 	RemoveAllSystems();
@@ -15,6 +17,57 @@ void SystemHolder::RemoveAllSystems() {
 
 	systems.clear();
 	priorities.clear();
+	matchingDirty = true;
+	scheduleDirty = true;
+}
+
+System *SystemHolder::GetSystem(TypeId typeId) const {
+	const auto it = systems.find(typeId);
+	return it != systems.end() ? it->second.get() : nullptr;
+}
+
+void SystemHolder::ForEachParallel(ThreadPool &pool, const std::function<void(System &, TypeId)> &func) {
+	UpdateSchedule();
+
+	if (remainingSize < schedule.size()) {
+		remaining = std::make_unique<std::atomic<std::size_t>[]>(schedule.size());
+		remainingSize = schedule.size();
+	}
+
+	for (std::size_t i = 0; i < schedule.size(); ++i) {
+		remaining[i].store(schedule[i].dependencies, std::memory_order_relaxed);
+	}
+
+	ThreadPool::TaskGroup group;
+	std::function<void(std::size_t)> run = [&](std::size_t i) {
+		auto &node = schedule[i];
+		CommandBuffer::Scope scope(CommandBuffer::MakeKey(static_cast<std::uint32_t>(i + 1), 0));
+
+		try {
+			func(*node.system, node.typeId);
+		} catch (const std::exception &e) {
+			std::cerr << e.what() << '\n';
+		}
+
+		// Queues the Systems that were only waiting on this one.
+		for (const auto &dependent : node.dependents) {
+			if (remaining[dependent].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+				pool.Run(group, [&run, dependent] {
+					run(dependent);
+				});
+			}
+		}
+	};
+
+	for (std::size_t i = 0; i < schedule.size(); ++i) {
+		if (schedule[i].dependencies == 0) {
+			pool.Run(group, [&run, i] {
+				run(i);
+			});
+		}
+	}
+
+	pool.Wait(group);
 }
 
 void SystemHolder::RemoveSystemPriority(TypeId id) {
@@ -26,4 +79,116 @@ void SystemHolder::RemoveSystemPriority(TypeId id) {
 		}
 	}
 }
+
+void SystemHolder::UpdateSchedule() {
+	// Filters may declare more access after their System has been added, the versions catch that without comparing masks.
+	if (!scheduleDirty && std::all_of(schedule.begin(), schedule.end(), [](const ScheduleNode &node) {
+		return node.accessVersion == node.system->GetFilter().GetAccessVersion();
+	})) {
+		return;
+	}
+
+	schedule.clear();
+
+	for (const auto &[priority, typeId] : priorities) {
+		if (auto &system = systems[typeId]) {
+			schedule.emplace_back(ScheduleNode{system.get(), typeId, system->GetFilter().GetAccessVersion(), 0, {}});
+		}
+	}
+
+	for (std::size_t i = 0; i < schedule.size(); ++i) {
+		for (std::size_t j = 0; j < i; ++j) {
+			// Higher priority Systems that conflict must finish first.
+			if (schedule[i].system->GetFilter().Conflicts(schedule[j].system->GetFilter())) {
+				schedule[j].dependents.emplace_back(i);
+				++schedule[i].dependencies;
+			}
+		}
+	}
+
+	scheduleDirty = false;
+}
+
+void SystemHolder::UpdateMatching() {
+	if (!matchingDirty) {
+		return;
+	}
+
+	matchingOrder.clear();
+	interested.clear();
+	matchCache.clear();
+
+	for (const auto &[priority, typeId] : priorities) {
+		if (auto &system = systems[typeId]) {
+			matchingOrder.emplace_back(MatchingNode{system.get(), typeId});
+		}
+	}
+
+	for (std::size_t position = 0; position < matchingOrder.size(); ++position) {
+		const auto &filter = matchingOrder[position].system->GetFilter();
+		const auto mentioned = filter.GetRequired() | filter.GetExcluded();
+
+		mentioned.ForEach([this, position](std::size_t bit) {
+			if (bit >= interested.size()) {
+				interested.resize(bit + 1);
+			}
+
+			interested[bit].emplace_back(position);
+		});
+	}
+
+	visited.assign(matchingOrder.size(), 0);
+	visitStamp = 0;
+	matchingDirty = false;
+}
+
+const std::vector<std::size_t> &SystemHolder::GetMatching(const ComponentFilter::Mask &mask) {
+	UpdateMatching();
+
+	if (auto it = matchCache.find(mask); it != matchCache.end()) {
+		return it->second;
+	}
+
+	// Bounds the cache when masks keep changing.
+	if (matchCache.size() >= 4096) {
+		matchCache.clear();
+	}
+
+	std::vector<std::size_t> matching;
+
+	for (std::size_t position = 0; position < matchingOrder.size(); ++position) {
+		if (matchingOrder[position].system->GetFilter().Check(mask)) {
+			matching.emplace_back(position);
+		}
+	}
+
+	return matchCache.emplace(mask, std::move(matching)).first->second;
+}
+
+const std::vector<std::size_t> &SystemHolder::GetInterested(const ComponentFilter::Mask &changed) {
+	UpdateMatching();
+
+	candidates.clear();
+
+	if (++visitStamp == 0) {
+		std::fill(visited.begin(), visited.end(), 0);
+		visitStamp = 1;
+	}
+
+	changed.ForEach([this](std::size_t bit) {
+		if (bit >= interested.size()) {
+			return;
+		}
+
+		for (const auto &position : interested[bit]) {
+			if (visited[position] != visitStamp) {
+				visited[position] = visitStamp;
+				candidates.emplace_back(position);
+			}
+		}
+	});
+
+	std::sort(candidates.begin(), candidates.end());
+	return candidates;
+}
 }
@@ -3,7 +3,9 @@
 #include <map>
 
 #include "Utils/NonCopyable.hpp"
+#include "Utils/ThreadPool.hpp"
 #include "Utils/TypeInfo.hpp"
+#include "Scenes/CommandBuffer.hpp"
 #include "Scenes/System.hpp"
 
 namespace acid {
@@ -59,6 +61,8 @@ public:
 
 		// Then, add the System
 		systems[typeId] = std::move(system);
+		matchingDirty = true;
+		scheduleDirty = true;
 	}
 
 	/**
@@ -80,22 +84,35 @@ public:
 
 		// Then, remove the System.
 		systems.erase(typeId);
+		matchingDirty = true;
+		scheduleDirty = true;
 	}
 
+	/**
+	 * Gets a System by type ID.
+	 * @param typeId The System type ID.
+	 * @return The System, or nullptr if there is no System of this type.
+	 */
+	System *GetSystem(TypeId typeId) const;
+
 	/**
 	 * Removes all Systems.
 	 */
 	void RemoveAllSystems();
 
 	/**
-	 * Iterates through all valid Systems.
+	 * Iterates through all valid Systems. Commands recorded by each System are ordered by its position.
 	 * @tparam Func The function type.
 	 * @param func The function to pass each System into, System object and System ID.
 	 */
 	template<typename Func>
 	void ForEach(Func &&func) {
+		std::uint32_t position = 0;
+
 		for (const auto &typeId : priorities) {
 			if (auto &system = systems[typeId.second]) {
+				CommandBuffer::Scope scope(CommandBuffer::MakeKey(++position, 0));
+
 				try {
 					func(*system, typeId.second);
 				} catch (const std::exception & e) {
@@ -105,14 +122,120 @@ public:
 		}
 	}
 
+	/**
+	 * Iterates through the Systems whose filter an Entity mask matches, in priority order.
+	 * Results are cached per mask until a System is added or removed.
+	 * @tparam Func The function type.
+	 * @param mask The Entity Component mask.
+	 * @param func The function to pass each System into, System object and System ID.
+	 */
+	template<typename Func>
+	void ForEachMatching(const ComponentFilter::Mask &mask, Func &&func) {
+		for (const auto &position : GetMatching(mask)) {
+			func(*matchingOrder[position].system, matchingOrder[position].typeId);
+		}
+	}
+
+	/**
+	 * Iterates through the Systems whose filter requires or excludes one of the changed Components, in priority order.
+	 * Other Systems cannot change their decision about an Entity whose mask only changed by these Components.
+	 * @tparam Func The function type.
+	 * @param changed The Component bits that changed.
+	 * @param func The function to pass each System into, System object and System ID.
+	 */
+	template<typename Func>
+	void ForEachInterested(const ComponentFilter::Mask &changed, Func &&func) {
+		for (const auto &position : GetInterested(changed)) {
+			func(*matchingOrder[position].system, matchingOrder[position].typeId);
+		}
+	}
+
+	/**
+	 * Runs a function on all valid Systems using a thread pool.
+	 * Systems whose Component access does not conflict run concurrently, conflicting Systems run in priority order.
+	 * Commands recorded by each System are ordered by its position, as with ForEach.
+	 * @param pool The thread pool.
+	 * @param func The function to pass each System into, System object and System ID.
+	 */
+	void ForEachParallel(ThreadPool &pool, const std::function<void(System &, TypeId)> &func);
+
 private:
+	class ScheduleNode {
+	public:
+		System *system;
+		TypeId typeId;
+
+		/// The access version of the System filter the dependencies were built from.
+		std::uint32_t accessVersion;
+
+		/// Number of conflicting Systems that run before this one.
+		std::size_t dependencies = 0;
+
+		/// Indices of the conflicting Systems that run after this one.
+		std::vector<std::size_t> dependents;
+	};
+
+	class MatchingNode {
+	public:
+		System *system;
+		TypeId typeId;
+	};
+
 	/// Remove System from the priority list.
 	void RemoveSystemPriority(TypeId id);
 
+	/// Rebuilds the System order and the Component to interested Systems index, if Systems changed.
+	void UpdateMatching();
+
+	/**
+	 * Gets the positions in matchingOrder of the Systems an Entity mask matches.
+	 * @param mask The Entity Component mask.
+	 * @return The System positions, in priority order.
+	 */
+	const std::vector<std::size_t> &GetMatching(const ComponentFilter::Mask &mask);
+
+	/**
+	 * Gets the positions in matchingOrder of the Systems interested in changed Components.
+	 * @param changed The Component bits that changed.
+	 * @return The System positions, in priority order.
+	 */
+	const std::vector<std::size_t> &GetInterested(const ComponentFilter::Mask &changed);
+
+	/// Rebuilds the System dependency graph from the priorities and declared Component access, if Systems or their access changed.
+	void UpdateSchedule();
+
 	/// List of all Systems.
 	std::unordered_map<TypeId, std::unique_ptr<System>> systems;
 
 	/// List of systems priorities.
 	std::multimap<std::size_t, TypeId, std::greater<>> priorities;
+
+	/// Valid Systems in priority order, used by matching.
+	std::vector<MatchingNode> matchingOrder;
+
+	/// Positions in matchingOrder of the Systems whose filter mentions a Component.
+	/// The index of this array matches the Component type ID.
+	std::vector<std::vector<std::size_t>> interested;
+
+	/// Positions in matchingOrder of the Systems each Entity mask matches.
+	std::unordered_map<ComponentFilter::Mask, std::vector<std::size_t>> matchCache;
+
+	/// Scratch state used to gather interested Systems without duplicates.
+	std::vector<std::size_t> candidates;
+	std::vector<std::uint32_t> visited;
+	std::uint32_t visitStamp = 0;
+
+	/// If Systems have been added or removed since the matching index was built.
+	bool matchingDirty = true;
+
+	/// System dependency graph, in priority order.
+	std::vector<ScheduleNode> schedule;
+
+	/// If Systems have been added or removed since the dependency graph was built.
+	bool scheduleDirty = true;
+
+	/// Dependencies left to run for each node of the schedule during ForEachParallel.
+	std::unique_ptr<std::atomic<std::size_t>[]> remaining;
+	std::size_t remainingSize = 0;
 };
 }
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Utils/MemoryUsage.hpp"
+#include "Utils/TypeInfo.hpp"
+
+namespace acid {
+/**
+ * @brief A report of the memory used and reserved by the structures of a Scene, from Scene::GetMemoryStats.
+ * Sizes count the memory the structures allocated, hash map nodes are estimated.
+ */
+class ACID_EXPORT MemoryStats {
+public:
+	/**
+	 * @brief The storage of a Component type.
+	 */
+	class ComponentStats {
+	public:
+		TypeId typeId;
+
+		/// Component type name, the name the type is registered with if it is, otherwise the type name.
+		std::string name;
+
+		/// Number of Components.
+		std::size_t count;
+
+		/// Components, their Entity IDs and change ticks, and the sparse pages mapping Entities to them.
+		MemoryUsage storage;
+	};
+
+	/**
+	 * @brief The Entity lists of a System.
+	 */
+	class SystemStats {
+	public:
+		TypeId typeId;
+
+		/// System type name, demangled where the compiler mangles it.
+		const char *name;
+
+		MemoryUsage enabledEntities;
+		MemoryUsage disabledEntities;
+
+		/// The sparse pages of Entity attach status and list positions.
+		MemoryUsage status;
+	};
+
+	/// Storage of each Component type with a pool.
+	std::vector<ComponentStats> components;
+
+	/// Component masks of all Entities.
+	MemoryUsage componentMasks;
+
+	/// Entity attributes, with their names, masks and System lists.
+	MemoryUsage entityAttributes;
+
+	/// Entity lists of each System.
+	std::vector<SystemStats> systems;
+
+	/// Entity names map.
+	MemoryUsage names;
+
+	/// Indices of the Entities with queued actions, and their scratch copy.
+	MemoryUsage actions;
+
+	/// Entity IDs waiting to be recycled.
+	MemoryUsage storedIds;
+
+	/// Parent and child links, the depth first order and the dirty and detached marks.
+	MemoryUsage hierarchy;
+
+	/// Recorded commands and their Components, and the scratch order they are applied in.
+	MemoryUsage commandBuffers;
+
+	/// Component signals with the Entities waiting to be signaled, and the scratch Entities being signaled.
+	MemoryUsage componentSignals;
+
+	/// Scratch Components resolved while propagating the hierarchy, and the tick each type was propagated at.
+	MemoryUsage propagatedComponents;
+
+	/// Sum of all the above.
+	MemoryUsage total;
+
+	/// Largest totals of the reports made by the Scene so far, including this one. Peaks between reports are not seen.
+	MemoryUsage largestReported;
+};
+}
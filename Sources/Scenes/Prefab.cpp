@@ -0,0 +1,95 @@
+#include "Prefab.hpp"
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+#include "Scene.hpp"
+
+namespace acid {
+Prefab::Prefab(const std::string &filename) {
+	std::ifstream file(filename, std::ios::binary | std::ios::ate);
+
+	if (!file) {
+		throw std::runtime_error("Failed to open prefab " + filename);
+	}
+
+	// The snapshot is read into aligned blocks, as a view requires.
+	class alignas(Snapshot::Alignment) Block {
+	public:
+		char bytes[Snapshot::Alignment];
+	};
+
+	const auto size = static_cast<std::size_t>(file.tellg());
+	std::vector<Block> blocks(Snapshot::Align(size) / sizeof(Block));
+	file.seekg(0);
+
+	if (!file.read(reinterpret_cast<char *>(blocks.data()), static_cast<std::streamsize>(size))) {
+		throw std::runtime_error("Failed to read prefab " + filename);
+	}
+
+	Compile(Snapshot::View(blocks.data(), size));
+}
+
+Prefab::Prefab(const Snapshot::View &view) {
+	Compile(view);
+}
+
+std::vector<Entity> Prefab::Instantiate(Scene &scene, std::size_t count) const {
+	// Entities are matched with Systems by their pending Enable action, so no Refresh is needed.
+	auto created = scene.CreateEntities(count);
+	std::vector<Entity::Id> ids;
+	ids.reserve(created.size());
+
+	for (const auto &entity : created) {
+		ids.emplace_back(entity.GetId());
+	}
+
+	for (const auto &component : components) {
+		auto &pool = scene.components.AssurePool(*component.type);
+
+		if (component.format == SnapshotFormat::Plain) {
+			pool.LoadSnapshot(ids.data(), ids.size(), component.data.data());
+		} else {
+			for (const auto &id : ids) {
+				Snapshot::StreamBuffer buffer(component.data.data(), component.data.size());
+				std::istream stream(&buffer);
+				pool.LoadSnapshot(id, stream);
+			}
+		}
+	}
+
+	for (const auto &id : ids) {
+		scene.components.MarkAdded(id, mask);
+
+		if (!enabled) {
+			scene.DisableEntity(id);
+		}
+	}
+
+	return created;
+}
+
+void Prefab::Compile(const Snapshot::View &view) {
+	if (view.GetEntityCount() == 0) {
+		throw std::runtime_error("Prefab snapshot has no Entity");
+	}
+
+	enabled = view.IsEntityEnabled(0);
+
+	view.ForEachComponent(0, [this](const Component::RegisteredType &type, const Snapshot::SectionHeader &header, const char *data, std::size_t size) {
+		// Records written by an older build of the Component type are skipped, as when loading a snapshot.
+		if (type.snapshotFormat != header.format || type.snapshotStride != header.stride) {
+			std::cerr << "Skipping Component " << std::quoted(type.name) << " in prefab, its snapshot format has changed\n";
+			return;
+		}
+
+		if (type.typeId >= MAX_COMPONENTS) {
+			throw std::runtime_error("Component type ID is out of range");
+		}
+
+		components.emplace_back(ComponentRecord{&type, header.format, std::vector<char>(data, data + size)});
+		mask.Set(type.typeId);
+	});
+}
+}
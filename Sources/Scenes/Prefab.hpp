@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Holders/ComponentFilter.hpp"
+#include "Snapshot.hpp"
+
+namespace acid {
+/**
+ * @brief An Entity template compiled from a snapshot, the first Entity of the snapshot is the template.
+ * The Component types, their mask and their default values are read once, each instance then copies the stored records.
+ */
+class ACID_EXPORT Prefab {
+public:
+	/**
+	 * Compiles a prefab from a snapshot file.
+	 * @param filename The snapshot file.
+	 */
+	explicit Prefab(const std::string &filename);
+
+	/**
+	 * Compiles a prefab from a snapshot in memory, the snapshot is not used after compiling.
+	 * @param view The snapshot.
+	 */
+	explicit Prefab(const Snapshot::View &view);
+
+	/**
+	 * Creates Entities from the prefab. Storage is grown once per Component type,
+	 * and each Entity is matched against the Systems once, when it is enabled.
+	 * @param scene The Scene.
+	 * @param count The number of Entities.
+	 * @return The Entities.
+	 */
+	std::vector<Entity> Instantiate(Scene &scene, std::size_t count) const;
+
+	/**
+	 * Gets the mask of the Component types of the prefab.
+	 * @return The Component mask.
+	 */
+	const ComponentFilter::Mask &GetMask() const noexcept { return mask; }
+
+	/**
+	 * Gets if the Entities created from the prefab are enabled.
+	 * @return If the Entities are enabled.
+	 */
+	bool IsEnabled() const noexcept { return enabled; }
+
+private:
+	class ComponentRecord {
+	public:
+		const Component::RegisteredType *type;
+		SnapshotFormat format;
+		/// The plain record, or the stream of the Component.
+		std::vector<char> data;
+	};
+
+	/**
+	 * Reads the Components of the template Entity.
+	 * @param view The snapshot.
+	 */
+	void Compile(const Snapshot::View &view);
+
+	std::vector<ComponentRecord> components;
+	ComponentFilter::Mask mask;
+	bool enabled = true;
+};
+}
@@ -1,12 +1,15 @@
 #include "Scene.hpp"
 
+#include <algorithm>
 #include <iostream>
+#include <tuple>
 
 #include "Entity.inl"
 
 namespace acid {
 Scene::Scene(std::unique_ptr<Camera> &&camera) :
 	camera(std::move(camera)) {
+	commandBuffers.emplace_back(std::make_unique<CommandBuffer>());
 }
 
 Scene::~Scene() {
@@ -19,17 +22,18 @@ void Scene::RemoveAllSystems() {
 
 Entity Scene::CreateEntity() {
 	const auto id = pool.Create();
+	const auto index = Entity::GetIndex(id);
 
 	// Resize containers if necessary.
-	Extend(id + 1);
+	Extend(index + 1);
 
-	entities[id].entity = Entity(id, this);
-	entities[id].enabled = true;
-	entities[id].valid = true;
+	entities[index].entity = Entity(id, this);
+	entities[index].enabled = true;
+	entities[index].matched = false;
 
-	EnableEntity(entities[id].entity);
+	EnableEntity(id);
 
-	return entities[id].entity;
+	return entities[index].entity;
 }
 
 Entity Scene::CreateEntity(const std::string &name) {
@@ -40,17 +44,62 @@ Entity Scene::CreateEntity(const std::string &name) {
 	const auto entity = CreateEntity();
 
 	names[name] = entity.GetId();
-	entities[entity.GetId()].name = name;
+	entities[entity.GetIndex()].name = name;
 
 	return entity;
 }
 
+std::vector<Entity> Scene::CreateEntities(std::size_t count) {
+	std::vector<Entity> created;
+	created.reserve(count);
+
+	Entity::Index maxIndex = 0;
+
+	for (std::size_t i = 0; i < count; ++i) {
+		const auto id = pool.Create();
+		maxIndex = std::max(maxIndex, Entity::GetIndex(id));
+		created.emplace_back(id, this);
+	}
+
+	if (count != 0) {
+		Extend(maxIndex + 1);
+	}
+
+	dirtyEntities.reserve(dirtyEntities.size() + count);
+
+	for (const auto &entity : created) {
+		auto &attributes = entities[entity.GetIndex()];
+		attributes.entity = entity;
+		attributes.enabled = true;
+		attributes.matched = false;
+
+		QueueAction(entity.GetId(), Action::Enable);
+	}
+
+	return created;
+}
+
 Entity Scene::CreatePrefabEntity(const std::string &filename) {
-	auto entity = CreateEntity();
-	// TODO
-	//auto prefab = EntityPrefab(filename);
-	//prefab >> entity;
-	return entity;
+	return GetPrefab(filename).Instantiate(*this, 1).front();
+}
+
+std::vector<Entity> Scene::CreatePrefabEntities(const std::string &filename, std::size_t count) {
+	return GetPrefab(filename).Instantiate(*this, count);
+}
+
+const Prefab &Scene::GetPrefab(const std::string &filename) {
+	auto &prefab = prefabs[filename];
+
+	if (!prefab) {
+		try {
+			prefab = std::make_unique<Prefab>(filename);
+		} catch (...) {
+			prefabs.erase(filename);
+			throw;
+		}
+	}
+
+	return *prefab;
 }
 
 std::optional<Entity> Scene::GetEntity(Entity::Id id) const {
@@ -58,7 +107,7 @@ std::optional<Entity> Scene::GetEntity(Entity::Id id) const {
 		return std::nullopt;
 	}
 
-	return entities[id].entity;
+	return entities[Entity::GetIndex(id)].entity;
 }
 
 std::optional<Entity> Scene::GetEntity(const std::string &name) const {
@@ -71,20 +120,40 @@ std::optional<Entity> Scene::GetEntity(const std::string &name) const {
 	return GetEntity(it->second);
 }
 
+std::vector<Entity> Scene::QueryEntities(const ComponentFilter &filter) const {
+	// A local buffer, Systems updated in parallel may query at the same time.
+	const auto &masks = components.GetComponentsMasks();
+	std::vector<std::uint8_t> matches(masks.size());
+	filter.Check(masks.data(), masks.size(), matches.data());
+
+	std::vector<Entity> result;
+
+	for (std::size_t index = 0; index < masks.size(); ++index) {
+		// Removed Entities have an empty mask, that may match.
+		if (matches[index] && entities[index].entity.GetId() != Entity::NullId) {
+			result.emplace_back(entities[index].entity);
+		}
+	}
+
+	return result;
+}
+
 std::string Scene::GetEntityName(Entity::Id id) const {
 	if (!IsEntityValid(id)) {
 		throw std::runtime_error("Entity ID is not valid");
 	}
 
-	if (entities[id].name.has_value()) {
-		return entities[id].name.value();
+	const auto &attributes = entities[Entity::GetIndex(id)];
+
+	if (attributes.name.has_value()) {
+		return attributes.name.value();
 	}
 
 	return {};
 }
 
 bool Scene::IsEntityEnabled(Entity::Id id) const {
-	return IsEntityValid(id) && entities[id].enabled;
+	return IsEntityValid(id) && entities[Entity::GetIndex(id)].enabled;
 }
 
 void Scene::EnableEntity(Entity::Id id) {
@@ -92,7 +161,7 @@ void Scene::EnableEntity(Entity::Id id) {
 		throw std::runtime_error("Entity ID is not valid");
 	}
 
-	actions.emplace_back(EntityAction(id, EntityAction::Action::Enable));
+	QueueAction(id, Action::Enable);
 }
 
 void Scene::DisableEntity(Entity::Id id) {
@@ -100,11 +169,14 @@ void Scene::DisableEntity(Entity::Id id) {
 		throw std::runtime_error("Entity ID is not valid");
 	}
 
-	actions.emplace_back(EntityAction(id, EntityAction::Action::Disable));
+	QueueAction(id, Action::Disable);
 }
 
 bool Scene::IsEntityValid(Entity::Id id) const {
-	return id < entities.size() && entities[id].valid;
+	const auto index = Entity::GetIndex(id);
+
+	// Removed Entities have their slot ID reset, so stale IDs never match.
+	return index < entities.size() && entities[index].entity.GetId() == id;
 }
 
 void Scene::RemoveEntity(Entity::Id id) {
@@ -112,7 +184,7 @@ void Scene::RemoveEntity(Entity::Id id) {
 		throw std::runtime_error("Entity ID is not valid");
 	}
 
-	actions.emplace_back(EntityAction(id, EntityAction::Action::Remove));
+	QueueAction(id, Action::Remove);
 }
 
 void Scene::RefreshEntity(Entity::Id id) {
@@ -120,135 +192,584 @@ void Scene::RefreshEntity(Entity::Id id) {
 		throw std::runtime_error("Entity ID is not valid");
 	}
 
-	actions.emplace_back(EntityAction(id, EntityAction::Action::Refresh));
+	QueueAction(id, Action::Refresh);
 }
 
 void Scene::RemoveAllEntities() {
 	for (const auto &entity : entities) {
 		// We may iterate through invalid entities.
-		if (entity.valid) {
+		if (IsEntityValid(entity.entity.GetId())) {
 			RemoveEntity(entity.entity.GetId());
 		}
 	}
 }
 
+void Scene::SetParent(Entity::Id id, Entity::Id parent) {
+	if (!IsEntityValid(id) || (parent != Entity::NullId && !IsEntityValid(parent))) {
+		throw std::runtime_error("Entity ID is not valid");
+	}
+
+	hierarchy.SetParent(id, parent);
+}
+
 void Scene::Update(float delta) {
-	// Start new Systems
-	for (auto &system : newSystems) {
-		system->OnStart();
+	profiler.BeginFrame();
+
+	{
+		Profiler::Scope scope(profiler, "StartSystems");
+
+		// Start new Systems, and attach the existing Entities they match.
+		for (std::size_t i = 0; i < newSystems.size(); ++i) {
+			if (auto system = systems.GetSystem(newSystems[i])) {
+				system->OnStart();
+				MatchSystem(*system, newSystems[i]);
+			}
+		}
+
+		newSystems.clear();
+	}
+
+	{
+		Profiler::Scope scope(profiler, "UpdateEntities");
+		UpdateEntities();
+	}
+
+	{
+		Profiler::Scope scope(profiler, "UpdateSystems");
+		const auto update = [this, delta](System &system, TypeId) {
+			Profiler::Scope systemScope(profiler, system.GetName());
+
+			// Changes made during the update get the update tick, so the System only sees them again if another System changes them later.
+			system.runTick = components.AdvanceChangeTick();
+			system.Update(delta);
+			system.lastRunTick = system.runTick;
+			system.runTick = 0;
+		};
+
+		if (threadPool) {
+			systems.ForEachParallel(*threadPool, update);
+		} else {
+			systems.ForEach(update);
+		}
+	}
+
+	profiler.EndFrame();
+}
+
+CommandBuffer &Scene::GetCommands() {
+	return *commandBuffers[threadPool ? threadPool->GetWorkerIndex() : 0];
+}
+
+void Scene::SetThreadCount(std::size_t threadCount) {
+	if (threadCount == 0) {
+		threadPool = nullptr;
+	} else if (!threadPool || threadPool->GetThreadCount() != threadCount) {
+		threadPool = std::make_unique<ThreadPool>(threadCount);
+	}
+
+	// Buffers are never removed, they may hold commands not applied yet.
+	while (commandBuffers.size() < threadCount + 1) {
+		commandBuffers.emplace_back(std::make_unique<CommandBuffer>());
 	}
+}
+
+void Scene::SetMemoryResource(std::pmr::memory_resource *upstream) {
+	components.SetMemoryResource(upstream);
+}
+
+MemoryStats Scene::GetMemoryStats() {
+	MemoryStats stats;
+
+	for (const auto &componentPool : components.GetPools()) {
+		if (componentPool) {
+			const auto typeId = static_cast<TypeId>(&componentPool - components.GetPools().data());
+			const auto registeredType = Component::GetRegisteredType(typeId);
+			stats.components.push_back({
+				typeId, registeredType ? registeredType->name : componentPool->GetTypeName(), componentPool->GetSize(), componentPool->GetMemoryUsage()
+			});
+			stats.total += stats.components.back().storage;
+		}
+	}
+
+	stats.componentMasks = MemoryUsage::Of(components.GetComponentsMasks());
+
+	for (const auto &mask : components.GetComponentsMasks()) {
+		stats.componentMasks += {mask.GetHeapSize(), mask.GetHeapSize()};
+	}
+
+	stats.entityAttributes = MemoryUsage::Of(entities);
 
-	newSystems.clear();
+	for (const auto &attributes : entities) {
+		stats.entityAttributes += {attributes.mask.GetHeapSize(), attributes.mask.GetHeapSize()};
+		stats.entityAttributes += MemoryUsage::Of(attributes.systems);
 
-	UpdateEntities();
-	systems.ForEach([delta](System &system, TypeId) {
-		system.Update(delta);
+		if (attributes.name) {
+			stats.entityAttributes += MemoryUsage::Of(*attributes.name);
+		}
+	}
+
+	systems.ForEach([&stats](System &system, TypeId typeId) {
+		stats.systems.push_back({
+			typeId, system.GetName(), MemoryUsage::Of(system.enabledEntities), MemoryUsage::Of(system.disabledEntities), system.slots.GetMemoryUsage()
+		});
+		stats.total += stats.systems.back().enabledEntities;
+		stats.total += stats.systems.back().disabledEntities;
+		stats.total += stats.systems.back().status;
 	});
+
+	// Nodes hold the pair, the next node and the cached hash.
+	constexpr auto nodeSize = sizeof(decltype(names)::value_type) + 2 * sizeof(void *);
+	stats.names = {names.size() * nodeSize, names.size() * nodeSize + names.bucket_count() * sizeof(void *)};
+
+	for (const auto &[name, id] : names) {
+		stats.names += MemoryUsage::Of(name);
+	}
+
+	// Only the queued Entities are in use, the updating ones are scratch kept for its capacity.
+	stats.actions = MemoryUsage::Of(dirtyEntities);
+	stats.actions.reserved += MemoryUsage::Of(updatingEntities).reserved;
+
+	stats.storedIds = pool.GetMemoryUsage();
+	stats.hierarchy = hierarchy.GetMemoryUsage();
+
+	stats.commandBuffers = MemoryUsage::Of(commandBuffers);
+	stats.commandBuffers.reserved += MemoryUsage::Of(commandOrder).reserved;
+
+	for (const auto &buffer : commandBuffers) {
+		stats.commandBuffers += {sizeof(CommandBuffer), sizeof(CommandBuffer)};
+		stats.commandBuffers += buffer->GetMemoryUsage();
+	}
+
+	stats.componentSignals = MemoryUsage::Of(componentSignals);
+	stats.componentSignals.reserved += MemoryUsage::Of(signalingEntities).reserved;
+
+	for (const auto &signals : componentSignals) {
+		if (signals) {
+			stats.componentSignals += {sizeof(ComponentSignals), sizeof(ComponentSignals)};
+			stats.componentSignals += MemoryUsage::Of(signals->addedEntities);
+			stats.componentSignals += MemoryUsage::Of(signals->removedEntities);
+		}
+	}
+
+	stats.propagatedComponents = MemoryUsage::Of(propagatedComponents);
+	stats.propagatedComponents += MemoryUsage::Of(propagatedTicks);
+
+	stats.total += stats.componentMasks;
+	stats.total += stats.entityAttributes;
+	stats.total += stats.names;
+	stats.total += stats.actions;
+	stats.total += stats.storedIds;
+	stats.total += stats.hierarchy;
+	stats.total += stats.commandBuffers;
+	stats.total += stats.componentSignals;
+	stats.total += stats.propagatedComponents;
+
+	largestReportedMemory.Max(stats.total);
+	stats.largestReported = largestReportedMemory;
+	return stats;
 }
 
 void Scene::Clear() {
 	RemoveAllSystems();
 
+	// Handles taken before the clear must stay invalid, the pool keeps every index version.
+	std::vector<Entity::Id> liveIds;
+
+	for (const auto &attributes : entities) {
+		if (const auto id = attributes.entity.GetId(); id != Entity::NullId) {
+			liveIds.emplace_back(id);
+		}
+	}
+
 	entities.clear();
-	actions.clear();
+	dirtyEntities.clear();
+	updatingEntities.clear();
 	names.clear();
+	hierarchy.Clear();
+	propagatedTicks.clear();
+
+	for (auto &signals : componentSignals) {
+		if (signals) {
+			signals->addedEntities.clear();
+			signals->removedEntities.clear();
+		}
+	}
+
+	for (auto &buffer : commandBuffers) {
+		buffer->Clear();
+	}
 
 	components.Clear();
-	pool.Reset();
+	pool.Reset(liveIds);
 }
 
 void Scene::UpdateEntities() {
-	// Here, we copy actions to make possible to create, enable, etc.
+	ApplyCommands();
+
+	// Here, we swap the lists to make possible to create, enable, etc.
 	// Entities within event handlers like system::onEntityAttached, etc.
-	const auto actionsList = std::move(actions);
-	actions = decltype(actions)();
+	updatingEntities.clear();
+	std::swap(updatingEntities, dirtyEntities);
 
-	for (const auto &action : actionsList) {
+	profiler.Count(Profiler::Counter::Actions, updatingEntities.size());
+
+	for (const auto &index : updatingEntities) {
 		try {
-			ExecuteAction(action);
+			ExecuteActions(index);
 		} catch (const std::exception & e) {
 			std::cout << e.what() << '\n';
 		}
 	}
+
+	InvokeSignals();
 }
 
-void Scene::ExecuteAction(const EntityAction &action) {
-	if (!IsEntityValid(action.id)) {
-		throw std::runtime_error("Entity action ID is not valid");
+void Scene::ApplyCommands() {
+	commandOrder.clear();
+
+	for (std::size_t buffer = 0; buffer < commandBuffers.size(); ++buffer) {
+		const auto &commands = commandBuffers[buffer]->commands;
+
+		for (std::size_t index = 0; index < commands.size(); ++index) {
+			commandOrder.emplace_back(CommandOrder{commands[index].key, static_cast<std::uint32_t>(buffer), static_cast<std::uint32_t>(index)});
+		}
+
+		commandBuffers[buffer]->created.assign(commandBuffers[buffer]->pendingCount, Entity::NullId);
 	}
 
-	switch (action.action) {
-	case EntityAction::Action::Enable:
-		ActionEnable(action.id);
-		break;
-	case EntityAction::Action::Disable:
-		ActionDisable(action.id);
+	if (commandOrder.empty()) {
+		return;
+	}
+
+	// Commands with the same key were recorded by one thread, the buffer index only orders commands recorded outside of Systems.
+	std::sort(commandOrder.begin(), commandOrder.end(), [](const CommandOrder &a, const CommandOrder &b) {
+		return std::tie(a.key, a.buffer, a.index) < std::tie(b.key, b.buffer, b.index);
+	});
+
+	for (const auto &order : commandOrder) {
+		auto &buffer = *commandBuffers[order.buffer];
+		auto &command = buffer.commands[order.index];
+		auto id = command.id;
+
+		try {
+			if (CommandBuffer::IsPending(id)) {
+				const auto pending = Entity::GetIndex(id);
+
+				if (command.type == CommandBuffer::Type::Create) {
+					buffer.created[pending] = CreateEntity().GetId();
+					continue;
+				}
+
+				id = pending < buffer.created.size() ? buffer.created[pending] : Entity::NullId;
+			}
+
+			switch (command.type) {
+			case CommandBuffer::Type::Create:
+				break;
+			case CommandBuffer::Type::Remove:
+				RemoveEntity(id);
+				break;
+			case CommandBuffer::Type::Enable:
+				EnableEntity(id);
+				break;
+			case CommandBuffer::Type::Disable:
+				DisableEntity(id);
+				break;
+			case CommandBuffer::Type::AddComponent:
+			case CommandBuffer::Type::RemoveComponent: {
+				if (!IsEntityValid(id)) {
+					throw std::runtime_error("Entity command ID is not valid");
+				}
+
+				Entity entity(id, this);
+				command.apply(entity, command.component);
+				break;
+			}
+			}
+		} catch (const std::exception &e) {
+			std::cout << e.what() << '\n';
+		}
+	}
+
+	for (auto &buffer : commandBuffers) {
+		buffer->Clear();
+	}
+}
+
+void Scene::QueueAction(Entity::Id id, Action action) {
+	auto &actions = entities[Entity::GetIndex(id)].actions;
+
+	if (actions == 0) {
+		dirtyEntities.emplace_back(Entity::GetIndex(id));
+	}
+
+	const auto bit = static_cast<std::uint8_t>(1 << static_cast<std::uint8_t>(action));
+
+	switch (action) {
+	case Action::Enable:
+		actions &= ~(1 << static_cast<std::uint8_t>(Action::Disable));
 		break;
-	case EntityAction::Action::Remove:
-		ActionRemove(action.id);
+	case Action::Disable:
+		actions &= ~(1 << static_cast<std::uint8_t>(Action::Enable));
 		break;
-	case EntityAction::Action::Refresh:
-		ActionRefresh(action.id);
+	default:
 		break;
 	}
+
+	actions |= bit;
+}
+
+void Scene::ExecuteActions(Entity::Index index) {
+	const auto queued = entities[index].actions;
+	const auto id = entities[index].entity.GetId();
+	const auto has = [queued](Action action) {
+		return (queued & (1 << static_cast<std::uint8_t>(action))) != 0;
+	};
+
+	// Actions queued from here on are executed by the next update.
+	entities[index].actions = 0;
+
+	if (queued == 0 || id == Entity::NullId) {
+		return;
+	}
+
+	// The mask of the Entity before its actions, against which signaled Component changes are found.
+	std::optional<ComponentFilter::Mask> previous;
+
+	if (signaledComponents.Any()) {
+		previous = entities[index].mask;
+	}
+
+	if (has(Action::Remove)) {
+		// Nothing else matters for an Entity that is removed.
+		ActionRemove(id);
+	} else if (has(Action::Enable)) {
+		// Enabling matches the Entity against the Systems, that includes any refresh.
+		ActionEnable(id);
+	} else if (has(Action::Disable)) {
+		entities[index].enabled = false;
+
+		// The Entity is attached to the Systems its Components match, without being enabled in them.
+		if (has(Action::Refresh) || !entities[index].matched) {
+			MatchEntity(id);
+		}
+
+		ActionDisable(id);
+	} else {
+		ActionRefresh(id);
+	}
+
+	if (previous) {
+		static const ComponentFilter::Mask empty;
+		RecordSignals(id, *previous, has(Action::Remove) ? empty : entities[index].mask);
+	}
+}
+
+Scene::ComponentSignals &Scene::AssureSignals(TypeId typeId) {
+	if (typeId >= MAX_COMPONENTS) {
+		throw std::runtime_error("Component type ID is out of range");
+	}
+
+	if (typeId >= componentSignals.size()) {
+		componentSignals.resize(typeId + 1);
+	}
+
+	if (!componentSignals[typeId]) {
+		componentSignals[typeId] = std::make_unique<ComponentSignals>();
+		signaledComponents.Set(typeId);
+	}
+
+	return *componentSignals[typeId];
+}
+
+void Scene::RecordSignals(Entity::Id id, const ComponentFilter::Mask &previous, const ComponentFilter::Mask &current) {
+	if (previous == current) {
+		return;
+	}
+
+	const auto changed = (previous ^ current) & signaledComponents;
+
+	changed.ForEach([&](std::size_t typeId) {
+		auto &signals = *componentSignals[typeId];
+
+		if (current.Test(typeId)) {
+			signals.addedEntities.emplace_back(id);
+		} else {
+			signals.removedEntities.emplace_back(id);
+		}
+	});
+}
+
+void Scene::InvokeSignals() {
+	const auto invoke = [this](ComponentSignal &signal, std::vector<Entity::Id> &pending) {
+		if (pending.empty()) {
+			return;
+		}
+
+		signalingEntities.clear();
+		std::swap(signalingEntities, pending);
+
+		try {
+			signal(signalingEntities.data(), signalingEntities.size());
+		} catch (const std::exception &e) {
+			std::cout << e.what() << '\n';
+		}
+	};
+
+	// Listeners may add signals, so the array is indexed and its size read on every iteration.
+	for (std::size_t typeId = 0; typeId < componentSignals.size(); ++typeId) {
+		if (auto signals = componentSignals[typeId].get()) {
+			// Removals first, so a listener tracking Entities never holds one twice.
+			invoke(signals->removed, signals->removedEntities);
+			invoke(signals->added, signals->addedEntities);
+		}
+	}
 }
 
 void Scene::ActionEnable(Entity::Id id) {
-	systems.ForEach([&](System &system, TypeId systemId) {
-		const auto attachStatus = TryEntityAttach(system, systemId, id);
+	const auto index = Entity::GetIndex(id);
+	entities[index].enabled = true;
+
+	MatchEntity(id);
 
-		if (attachStatus == EntityAttachStatus::AlreadyAttached || attachStatus == EntityAttachStatus::Attached) {
+	// System callbacks may create Entities, so attributes are accessed by index after each call.
+	for (std::size_t i = 0; i < entities[index].systems.size(); ++i) {
+		if (auto system = systems.GetSystem(entities[index].systems[i])) {
 			// The Entity is attached to the System, it is enabled.
-			system.EnableEntity(entities[id].entity);
+			system->EnableEntity(entities[index].entity);
 		}
-	});
+	}
 }
 
 void Scene::ActionDisable(Entity::Id id) {
-	entities[id].enabled = false;
+	const auto index = Entity::GetIndex(id);
+	entities[index].enabled = false;
 
-	systems.ForEach([&](System &system, TypeId systemId) {
-		// Is the Entity attached to the System?
-		if (systemId < entities[id].systems.size() && entities[id].systems[systemId]) {
-			system.DisableEntity(entities[id].entity);
+	for (std::size_t i = 0; i < entities[index].systems.size(); ++i) {
+		if (auto system = systems.GetSystem(entities[index].systems[i])) {
+			system->DisableEntity(entities[index].entity);
 		}
-	});
+	}
 }
 
 void Scene::ActionRemove(Entity::Id id) {
-	systems.ForEach([&](System &system, TypeId systemId) {
-		// Is the Entity attached to the System?
-		if (systemId < entities[id].systems.size() && entities[id].systems[systemId]) {
-			system.DetachEntity(entities[id].entity);
-			entities[id].systems[systemId] = false;
+	removedDescendants.clear();
+	hierarchy.GetDescendants(id, removedDescendants);
+
+	// Children first, the Entity ID may be stored and reused once its data is removed.
+	for (auto it = removedDescendants.rbegin(); it != removedDescendants.rend(); ++it) {
+		const auto descendant = *it;
+
+		if (signaledComponents.Any()) {
+			static const ComponentFilter::Mask empty;
+			RecordSignals(descendant, entities[Entity::GetIndex(descendant)].mask, empty);
 		}
-	});
+
+		RemoveEntityData(descendant);
+	}
+
+	RemoveEntityData(id);
+}
+
+void Scene::RemoveEntityData(Entity::Id id) {
+	const auto index = Entity::GetIndex(id);
+
+	for (std::size_t i = 0; i < entities[index].systems.size(); ++i) {
+		if (auto system = systems.GetSystem(entities[index].systems[i])) {
+			system->DetachEntity(entities[index].entity);
+		}
+	}
+
+	auto &attributes = entities[index];
 
 	// Invalidate the Entity and reset its attributes.
-	entities[id].valid = false;
-	entities[id].systems.clear();
+	attributes.entity = Entity();
+	attributes.matched = false;
+	attributes.mask.Clear();
+	attributes.systems.clear();
+
+	// Descendants are removed by their ancestor, their own queued actions are dropped.
+	attributes.actions = 0;
 
 	// Remove its name from the list
-	if (entities[id].name.has_value()) {
-		names.erase(entities[id].name.value());
-		entities[id].name.reset();
+	if (attributes.name.has_value()) {
+		names.erase(attributes.name.value());
+		attributes.name.reset();
 	}
 
+	hierarchy.Remove(id);
 	components.RemoveAllComponents(id);
 	pool.Store(id);
 }
 
 void Scene::ActionRefresh(Entity::Id id) {
-	systems.ForEach([&](System &system, TypeId systemId) {
+	const auto index = Entity::GetIndex(id);
+
+	if (!entities[index].matched) {
+		// Not enabled yet, its pending Enable action matches it.
+		return;
+	}
+
+	const auto mask = components.GetComponentsMask(id);
+	const auto changed = mask ^ entities[index].mask;
+	entities[index].mask = mask;
+
+	// Only Systems whose filter mentions a changed Component can change their decision.
+	systems.ForEachInterested(changed, [&](System &system, TypeId systemId) {
 		const auto attachStatus = TryEntityAttach(system, systemId, id);
 
-		if (entities[id].enabled && attachStatus == EntityAttachStatus::Attached) {
+		if (entities[index].enabled && attachStatus == EntityAttachStatus::Attached) {
 			// If the Entity has been attached and is enabled, enable it into the System.
-			system.EnableEntity(entities[id].entity);
+			system.EnableEntity(entities[index].entity);
 		}
 	});
 }
 
+void Scene::MatchEntity(Entity::Id id) {
+	const auto index = Entity::GetIndex(id);
+	const auto mask = components.GetComponentsMask(id);
+
+	if (entities[index].matched) {
+		const auto changed = mask ^ entities[index].mask;
+		entities[index].mask = mask;
+
+		systems.ForEachInterested(changed, [&](System &system, TypeId systemId) {
+			TryEntityAttach(system, systemId, id);
+		});
+		return;
+	}
+
+	// First match, the Entity is attached to no System yet.
+	entities[index].matched = true;
+	entities[index].mask = mask;
+
+	systems.ForEachMatching(mask, [&](System &system, TypeId systemId) {
+		TryEntityAttach(system, systemId, id);
+	});
+}
+
+void Scene::MatchSystem(System &system, TypeId systemId) {
+	const auto &masks = components.GetComponentsMasks();
+	matchResults.resize(masks.size());
+	system.GetFilter().Check(masks.data(), masks.size(), matchResults.data());
+
+	// Attach callbacks may create Entities, only Entities checked above are visited.
+	const auto count = masks.size();
+
+	for (std::size_t index = 0; index < count; ++index) {
+		const auto id = entities[index].entity.GetId();
+
+		// Entities that are not matched yet will be when their Enable action runs.
+		if (!matchResults[index] || !IsEntityValid(id) || !entities[index].matched) {
+			continue;
+		}
+
+		if (TryEntityAttach(system, systemId, id) == EntityAttachStatus::Attached && entities[index].enabled) {
+			system.EnableEntity(entities[index].entity);
+		}
+	}
+}
+
 void Scene::Extend(std::size_t size) {
 	if (size > entities.size()) {
 		entities.resize(size);
@@ -257,16 +778,21 @@ void Scene::Extend(std::size_t size) {
 }
 
 Scene::EntityAttachStatus Scene::TryEntityAttach(System &system, TypeId systemId, Entity::Id id) {
+	const auto index = Entity::GetIndex(id);
+	const auto attached = system.GetEntityStatus(id) != System::EntityStatus::NotAttached;
+
 	// Does the Entity match the requirements to be part of the System?
 	if (system.GetFilter().Check(components.GetComponentsMask(id))) {
 		// Is the Entity not already attached to the System?
-		if (systemId >= entities[id].systems.size() || !entities[id].systems[systemId]) {
-			if (systemId >= entities[id].systems.size()) {
-				entities[id].systems.resize(systemId + 1, false);
+		if (!attached) {
+			auto &attachedSystems = entities[index].systems;
+
+			// A removed System of the same type may still be listed.
+			if (std::find(attachedSystems.begin(), attachedSystems.end(), systemId) == attachedSystems.end()) {
+				attachedSystems.emplace_back(systemId);
 			}
 
-			entities[id].systems[systemId] = true;
-			system.AttachEntity(entities[id].entity);
+			system.AttachEntity(entities[index].entity);
 
 			// The Entity has been attached to the System.
 			return EntityAttachStatus::Attached;
@@ -277,9 +803,11 @@ Scene::EntityAttachStatus Scene::TryEntityAttach(System &system, TypeId systemId
 	}
 
 	// If the Entity is already attached to the System but doest not match the requirements anymore, we detach it from the System.
-	if (systemId < entities[id].systems.size() && entities[id].systems[systemId]) {
-		system.DetachEntity(entities[id].entity);
-		entities[id].systems[systemId] = false;
+	if (attached) {
+		auto &attachedSystems = entities[index].systems;
+		attachedSystems.erase(std::remove(attachedSystems.begin(), attachedSystems.end(), systemId), attachedSystems.end());
+
+		system.DetachEntity(entities[index].entity);
 
 		// The Entity has been detached from the System.
 		return EntityAttachStatus::Detached;
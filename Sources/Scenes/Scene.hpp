@@ -1,12 +1,19 @@
 #pragma once
 
 #include "Utils/Delegate.hpp"
+#include "Utils/Profiler.hpp"
+#include "Utils/ThreadPool.hpp"
 #include "Utils/TypeInfo.hpp"
 #include "Holders/ComponentHolder.hpp"
 #include "Holders/EntityPool.hpp"
+#include "Holders/Hierarchy.hpp"
 #include "Holders/SystemHolder.hpp"
 #include "Camera.hpp"
+#include "CommandBuffer.hpp"
 #include "Entity.hpp"
+#include "MemoryStats.hpp"
+#include "Prefab.hpp"
+#include "Snapshot.hpp"
 #include "System.hpp"
 
 namespace acid {
@@ -14,7 +21,13 @@ class ACID_EXPORT Scene : public virtual Observer {
 	friend class Scenes;
 	friend class Entity;
 	friend class System;
+	friend class Prefab;
+	friend class Snapshot;
+	template<typename> friend class SpatialIndex;
 public:
+	/// Signal of Components of a type added to or removed from Entities, with the Entity IDs and their count.
+	using ComponentSignal = Delegate<void(const Entity::Id *, std::size_t), DelegateMode::CopyOnWrite>;
+
 	/**
 	 * Creates a new scene.
 	 * @param camera The scenes camera.
@@ -83,6 +96,16 @@ public:
 	 */
 	void RemoveAllSystems();
 
+	/**
+	 * Declares an owning group of Component types, or gets it if it was declared already. The Entities that have all of the Components
+	 * are packed at the front of each pool in the same order, for Systems to iterate with ForEachGroup.
+	 * Throws if a type is already owned by a different group.
+	 * @tparam Ts The Component types.
+	 * @return The group.
+	 */
+	template<typename... Ts>
+	const ComponentGroup &AddGroup() { return components.AddGroup<Ts...>(); }
+
 	/**
 	 * Creates a new Entity.
 	 * @return The Entity.
@@ -96,13 +119,47 @@ public:
 	 */
 	Entity CreateEntity(const std::string &name);
 
+	/**
+	 * Creates several Entities, growing the Entity storage once.
+	 * @param count The number of Entities.
+	 * @return The Entities.
+	 */
+	std::vector<Entity> CreateEntities(std::size_t count);
+
+	/**
+	 * Creates several Entities with a copy of the same Components. Storage is grown once per Component type,
+	 * and each Entity is matched against the Systems once, when it is enabled.
+	 * @tparam Ts The Component types.
+	 * @param count The number of Entities.
+	 * @param components The Components copied to each Entity.
+	 * @return The Entities.
+	 */
+	template<typename... Ts>
+	std::vector<Entity> CreateEntities(std::size_t count, const Ts &...components);
+
 	/**
 	 * Creates a new Entity from a prefab.
-	 * @param filename The Entity prefab file.
+	 * @param filename The Entity prefab file, a snapshot compiled the first time it is used.
 	 * @return The Entity.
 	 */
 	Entity CreatePrefabEntity(const std::string &filename);
 
+	/**
+	 * Creates several Entities from a prefab, storage is grown once per Component type,
+	 * and each Entity is matched against the Systems once, when it is enabled.
+	 * @param filename The Entity prefab file, a snapshot compiled the first time it is used.
+	 * @param count The number of Entities.
+	 * @return The Entities.
+	 */
+	std::vector<Entity> CreatePrefabEntities(const std::string &filename, std::size_t count);
+
+	/**
+	 * Gets a prefab, compiling the prefab file the first time.
+	 * @param filename The Entity prefab file.
+	 * @return The prefab.
+	 */
+	const Prefab &GetPrefab(const std::string &filename);
+
 	/**
 	 * Gets a Entity by ID.
 	 * @param id The Entity ID.
@@ -117,6 +174,14 @@ public:
 	 */
 	std::optional<Entity> GetEntity(const std::string &name) const;
 
+	/**
+	 * Gets all Entities whose Components match a filter, enabled or not.
+	 * Can be called by Systems updated in parallel, as long as no Components are added or removed meanwhile.
+	 * @param filter The Component filter.
+	 * @return The Entities.
+	 */
+	std::vector<Entity> QueryEntities(const ComponentFilter &filter) const;
+
 	/**
 	 * Gets a Entity name.
 	 * @param id The Entity ID.
@@ -167,6 +232,53 @@ public:
 	 */
 	void RemoveAllEntities();
 
+	/**
+	 * Sets the parent of an Entity. Removing an Entity removes its descendants with it.
+	 * Hierarchy links change immediately, so they must not be changed while Systems are updated on worker threads.
+	 * @param id The Entity ID.
+	 * @param parent The parent Entity ID, NullId removes the Entity from its parent.
+	 */
+	void SetParent(Entity::Id id, Entity::Id parent);
+
+	/**
+	 * Gets the parent and child relations between the Entities.
+	 * @return The hierarchy.
+	 */
+	const Hierarchy &GetHierarchy() const { return hierarchy; }
+
+	/**
+	 * Propagates a Component down the dirty subtrees of the hierarchy, such as local transforms into world transforms.
+	 * A subtree is dirty if its links changed, or if the Component of its root was added or changed since the Component type was last propagated.
+	 * Entities that left the hierarchy since, by losing their parent or their last child, are visited once as roots.
+	 * The function is called for the Entities with the Component, parents before their children, the Components are marked as changed
+	 * at a tick of their own, so the propagated values do not make their subtrees dirty again.
+	 * Components of the type must not be added, removed or changed by other threads while propagating.
+	 * @tparam T The Component type.
+	 * @tparam Func The function type.
+	 * @param func The function, taking the Component and the Component of the parent, or nullptr for roots and parents without one.
+	 */
+	template<typename T, typename Func>
+	void PropagateHierarchy(Func &&func);
+
+	/**
+	 * Gets the signal of Components of a type added to Entities. It is invoked once per Entity update with all the Entities
+	 * that gained the Component since the last update, instead of once per Entity.
+	 * A Component added then removed before the update is not signaled, each signaled addition is followed by one removal signal.
+	 * @tparam T The Component type.
+	 * @return The signal.
+	 */
+	template<typename T>
+	ComponentSignal &OnAdded();
+
+	/**
+	 * Gets the signal of Components of a type removed from Entities, or from removed Entities. It is invoked once per Entity update
+	 * with all the Entities that lost the Component since the last update, the Components are already destroyed and removed Entities no longer valid.
+	 * @tparam T The Component type.
+	 * @return The signal.
+	 */
+	template<typename T>
+	ComponentSignal &OnRemoved();
+
 	/**
 	 * Updates the Scene.
 	 * @param delta The time delta between the last update.
@@ -174,61 +286,143 @@ public:
 	void Update(float delta);
 
 	/**
-	 * Clears the Scene by removing all Systems and Entities.
+	 * Gets the thread pool used to update Systems in parallel.
+	 * @return The thread pool, or nullptr if Systems are updated sequentially.
+	 */
+	ThreadPool *GetThreadPool() const { return threadPool.get(); }
+
+	/**
+	 * Gets the command buffer of the calling thread, for structural changes applied when the Scene next updates its Entities.
+	 * Can be used from the updating thread and the workers of the Scene thread pool.
+	 * @return The command buffer.
+	 */
+	CommandBuffer &GetCommands();
+
+	/**
+	 * Sets the number of threads used to update Systems. Systems that declared non conflicting Component access are updated concurrently,
+	 * and must record Entity creation, removal, enabling and disabling, and Component addition and removal, through GetCommands.
+	 * @param threadCount The number of worker threads, with 0 Systems are updated sequentially on the calling thread.
+	 */
+	void SetThreadCount(std::size_t threadCount);
+
+	/**
+	 * Gets the profiler that times the update phases and each System update, it is disabled until enabled.
+	 * @return The profiler.
+	 */
+	Profiler &GetProfiler() { return profiler; }
+	const Profiler &GetProfiler() const { return profiler; }
+
+	/**
+	 * Gets the memory used and reserved by the Scene structures, walking every Entity and System.
+	 * The largest totals are kept over the reports made so far, so they are only as fine as the calls.
+	 * @return The memory report.
+	 */
+	MemoryStats GetMemoryStats();
+
+	/**
+	 * Clears the Scene by removing all Systems and Entities. Component storage is released to the memory resource in bulk.
+	 * Component signals keep their listeners, the Components removed by clearing are not signaled.
 	 */
 	void Clear();
 
+	/**
+	 * Sets the memory resource Component storage slabs are allocated from, can only be called while no Entity has a Component.
+	 * @param upstream The memory resource, it must outlive the Scene or the next call.
+	 */
+	void SetMemoryResource(std::pmr::memory_resource *upstream);
+
 private:
 	class EntityAttributes {
 	public:
-		/// Entity.
+		/// Entity, holds a null ID once the Entity has been removed.
 		Entity entity;
 
 		/// Is this Entity enabled.
 		bool enabled = true;
 
-		/// Is this Entity valid (hasn't been removed).
-		bool valid = true;
+		/// Has this Entity been matched against the Systems, by its first Enable action.
+		bool matched = false;
+
+		/// The Component mask the Systems were last matched against.
+		ComponentFilter::Mask mask;
 
 		/// Entity name.
 		std::optional<std::string> name;
 
 		/// The Systems this Entity is attached.
 		std::vector<TypeId> systems;
+
+		/// Actions queued for the next Entity update, one bit per Action.
+		std::uint8_t actions = 0;
 	};
 
-	class EntityAction {
+	class ComponentSignals {
 	public:
-		enum class Action {
-			Enable, Disable, Remove, Refresh
-		};
+		ComponentSignal added;
+		ComponentSignal removed;
 
-		EntityAction(Entity::Id id, Action action) :
-			id(id),
-			action(action) {
-		}
-
-		/// Entity ID.
-		Entity::Id id;
+		/// Entities to signal on the next Entity update.
+		std::vector<Entity::Id> addedEntities;
+		std::vector<Entity::Id> removedEntities;
+	};
 
-		/// Action to perform on this Entity.
-		Action action;
+	enum class Action : std::uint8_t {
+		Enable, Disable, Remove, Refresh
 	};
 
 	enum class EntityAttachStatus {
 		Attached, AlreadyAttached, Detached, NotAttached
 	};
 
+	class CommandOrder {
+	public:
+		std::uint64_t key;
+		std::uint32_t buffer;
+		std::uint32_t index;
+	};
+
 	/**
 	 * Update the Entity actions within the World.
 	 */
 	void UpdateEntities();
 
 	/**
-	 * Executes an action.
-	 * @param action The action to execute.
+	 * Applies the commands of all command buffers, by order key, then buffer, then recording order.
 	 */
-	void ExecuteAction(const EntityAction &action);
+	void ApplyCommands();
+
+	/**
+	 * Queues an action for the next Entity update. Enable and Disable replace each other, Remove overrides every other action.
+	 * @param id The Entity ID.
+	 * @param action The action.
+	 */
+	void QueueAction(Entity::Id id, Action action);
+
+	/**
+	 * Executes the net change of the actions queued for an Entity, so it is matched against the Systems at most once.
+	 * @param index The Entity index.
+	 */
+	void ExecuteActions(Entity::Index index);
+
+	/**
+	 * Gets the signals of a Component type, creating them if needed.
+	 * @param typeId The Component type ID.
+	 * @return The signals.
+	 */
+	ComponentSignals &AssureSignals(TypeId typeId);
+
+	/**
+	 * Records the observed Components an Entity gained or lost, between the mask last signaled and its current one.
+	 * @param id The Entity ID.
+	 * @param previous The Component mask of the Entity before its actions were executed.
+	 * @param current The Component mask of the Entity now.
+	 */
+	void RecordSignals(Entity::Id id, const ComponentFilter::Mask &previous, const ComponentFilter::Mask &current);
+
+	/**
+	 * Invokes the signals of the Components added and removed since the last Entity update.
+	 */
+	void InvokeSignals();
 
 	/**
 	 * Adds the Entity to the Systems it meets the requirements.
@@ -243,11 +437,17 @@ private:
 	void ActionDisable(Entity::Id id);
 
 	/**
-	 * Removes the Entity data from the World.
+	 * Removes the Entity and its descendants data from the World.
 	 * @param id The Entity ID.
 	 */
 	void ActionRemove(Entity::Id id);
 
+	/**
+	 * Removes the Entity data from the World, without its descendants.
+	 * @param id The Entity ID.
+	 */
+	void RemoveEntityData(Entity::Id id);
+
 	/**
 	 * Attaches the Entity to the Systems it meets the requirements or detach it from the Systems it does not meet the requirements anymore.
 	 * Used after AddComponent and RemoveComponent.
@@ -255,6 +455,19 @@ private:
 	 */
 	void ActionRefresh(Entity::Id id);
 
+	/**
+	 * Matches the Entity against the Systems, all of them the first time, then only those interested in the Components that changed since.
+	 * @param id The Entity ID.
+	 */
+	void MatchEntity(Entity::Id id);
+
+	/**
+	 * Attaches the matched Entities that meet the requirements of a new System.
+	 * @param system The System.
+	 * @param systemId The System ID.
+	 */
+	void MatchSystem(System &system, TypeId systemId);
+
 	/**
 	 * Extends the Entity and Component arrays.
 	 * @param size The new size.
@@ -279,8 +492,35 @@ private:
 	/// List of all Entities.
 	std::vector<EntityAttributes> entities;
 
-	/// List of Entities that have been modified.
-	std::vector<EntityAction> actions;
+	/// Indices of the Entities with queued actions.
+	std::vector<Entity::Index> dirtyEntities;
+
+	/// Indices of the Entities being updated, swapped with dirtyEntities so both keep their capacity.
+	std::vector<Entity::Index> updatingEntities;
+
+	/// Component added and removed signals, the index of this array matches the Component type ID.
+	std::vector<std::unique_ptr<ComponentSignals>> componentSignals;
+
+	/// Component types with signals, the only ones Entity updates record changes of.
+	ComponentFilter::Mask signaledComponents;
+
+	/// Scratch Entities of the signal being invoked, swapped with the pending ones so listeners can add Components.
+	std::vector<Entity::Id> signalingEntities;
+
+	/// Parent and child relations between Entities.
+	Hierarchy hierarchy;
+
+	/// Scratch Components resolved by hierarchy position while propagating.
+	std::vector<void *> propagatedComponents;
+
+	/// The change tick each Component type was last propagated at, the index of this array matches the Component type ID.
+	std::vector<ComponentPoolBase::Tick> propagatedTicks;
+
+	/// Scratch descendants of the Entity being removed.
+	std::vector<Entity::Id> removedDescendants;
+
+	/// Compiled prefabs, by file name.
+	std::unordered_map<std::string, std::unique_ptr<Prefab>> prefabs;
 
 	/// List of all Entity names, associated to their Entities, for faster search.
 	std::unordered_map<std::string, Entity::Id> names;
@@ -291,11 +531,29 @@ private:
 	/// List of all Systems of the Scene.
 	SystemHolder systems;
 
+	/// Scratch results of the batched filter checks of MatchSystem.
+	std::vector<std::uint8_t> matchResults;
+
 	/// List of all System waiting to be started.
-	std::vector<System *> newSystems;
+	std::vector<TypeId> newSystems;
 
 	/// Entity ID Pool.
 	EntityPool pool;
+
+	/// Thread pool that Systems are updated on, if any.
+	std::unique_ptr<ThreadPool> threadPool;
+
+	/// Command buffers, one per worker of the thread pool followed by one for other threads.
+	std::vector<std::unique_ptr<CommandBuffer>> commandBuffers;
+
+	/// Scratch order of the commands being applied.
+	std::vector<CommandOrder> commandOrder;
+
+	/// Scene update timings and counters.
+	Profiler profiler;
+
+	/// Largest memory totals reported so far.
+	MemoryUsage largestReportedMemory;
 };
 }
 
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <typeinfo>
+
+#include "Utils/TypeName.hpp"
 #include "Scene.hpp"
 
 namespace acid {
@@ -15,18 +18,127 @@ T *Scene::GetSystem() const {
 
 template<typename T, typename... Args>
 T *Scene::AddSystem(std::size_t priority, Args &&...args) {
-	systems.AddSystem<T>(priority, std::make_unique<T>(std::forward<Args>(args)...));
+	auto created = std::make_unique<T>(std::forward<Args>(args)...);
+
+	// The group is created first, so a conflicting group leaves the Scene unchanged.
+	if (created->groupFactory) {
+		created->groupFactory(components);
+	}
+
+	systems.AddSystem<T>(priority, std::move(created));
 
 	auto system = GetSystem<T>();
-	newSystems.emplace_back(system);
+	newSystems.emplace_back(GetSystemTypeId<T>());
 
 	// Sets the System Scene.
 	system->scene = this;
+	system->name = GetTypeName(typeid(*system));
 	return system;
 }
 
+template<typename... Ts>
+std::vector<Entity> Scene::CreateEntities(std::size_t count, const Ts &...components) {
+	auto created = CreateEntities(count);
+
+	// Entities are matched with Systems by their pending Enable action, so no Refresh is needed.
+	std::vector<Entity::Id> ids;
+	ids.reserve(created.size());
+
+	for (const auto &entity : created) {
+		ids.emplace_back(entity.GetId());
+	}
+
+	this->components.AddComponents(ids.data(), ids.size(), components...);
+	return created;
+}
+
 template<typename T>
 void Scene::RemoveSystem() {
 	systems.RemoveSystem<T>();
 }
+
+template<typename T, typename Func>
+void Scene::PropagateHierarchy(Func &&func) {
+	auto pool = components.GetPool<T>();
+
+	if (!pool) {
+		hierarchy.Propagate([](Hierarchy::Position, Hierarchy::Position) {
+		}, [](Entity::Id) {
+		});
+		return;
+	}
+
+	const auto typeId = GetComponentTypeId<T>();
+
+	if (typeId >= propagatedTicks.size()) {
+		propagatedTicks.resize(typeId + 1, 0);
+	}
+
+	// Changes made from now on get a later tick than the propagated Components, so they are found by the next propagation.
+	const auto tick = components.AdvanceChangeTick();
+	const auto changedTicks = pool->GetChangedTicks();
+	const auto &ids = pool->GetEntities();
+
+	for (std::size_t index = 0; index < ids.size(); ++index) {
+		if (changedTicks[index] > propagatedTicks[typeId]) {
+			hierarchy.MarkDirty(ids[index]);
+		}
+	}
+
+	propagatedTicks[typeId] = tick;
+
+	const auto &order = hierarchy.GetOrder();
+
+	// Components resolved by position, parents are visited first so children read their parent from here.
+	propagatedComponents.resize(order.size());
+	auto resolved = reinterpret_cast<T **>(propagatedComponents.data());
+	auto rangeBegin = Hierarchy::NullPosition;
+	auto previous = Hierarchy::NullPosition;
+
+	hierarchy.Propagate([&](Hierarchy::Position position, Hierarchy::Position parentPosition) {
+		if (previous == Hierarchy::NullPosition || position != previous + 1) {
+			rangeBegin = position;
+		}
+
+		previous = position;
+
+		const auto index = pool->GetIndex(order[position]);
+
+		if (index == ComponentPoolBase::NullIndex) {
+			resolved[position] = nullptr;
+			return;
+		}
+
+		auto component = pool->GetData() + index;
+		pool->SetChangedTick(index, tick);
+		resolved[position] = component;
+
+		const T *parent = nullptr;
+
+		if (parentPosition != Hierarchy::NullPosition) {
+			// The parent of the first Entity of a dirty subtree was not visited.
+			parent = parentPosition >= rangeBegin ? resolved[parentPosition] : pool->Get(order[parentPosition]);
+		}
+
+		func(*component, parent);
+	}, [&](Entity::Id id) {
+		// Detached Entities are roots now, their values no longer come from the parent.
+		const auto index = pool->GetIndex(id);
+
+		if (index != ComponentPoolBase::NullIndex) {
+			pool->SetChangedTick(index, tick);
+			func(pool->GetData()[index], nullptr);
+		}
+	});
+}
+
+template<typename T>
+Scene::ComponentSignal &Scene::OnAdded() {
+	return AssureSignals(GetComponentTypeId<T>()).added;
+}
+
+template<typename T>
+Scene::ComponentSignal &Scene::OnRemoved() {
+	return AssureSignals(GetComponentTypeId<T>()).removed;
+}
 }
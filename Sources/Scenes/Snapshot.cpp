@@ -0,0 +1,580 @@
+#include "Snapshot.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "Scene.hpp"
+
+namespace acid {
+static constexpr char Magic[8] = {'A', 'C', 'I', 'D', 'S', 'N', 'A', 'P'};
+static constexpr std::uint32_t ByteOrder = 0x01020304;
+
+static void WriteBytes(std::ostream &stream, const void *data, std::size_t size) {
+	stream.write(static_cast<const char *>(data), static_cast<std::streamsize>(size));
+}
+
+static void WritePadding(std::ostream &stream, std::uint64_t size) {
+	static constexpr char zeros[Snapshot::Alignment] = {};
+	WriteBytes(stream, zeros, static_cast<std::size_t>(Snapshot::Align(size) - size));
+}
+
+static void WriteSection(std::ostream &stream, Snapshot::SectionType type, SnapshotFormat format, std::uint64_t count, std::uint64_t size,
+	const std::string &name = {}, std::uint32_t stride = 0) {
+	Snapshot::SectionHeader section = {};
+	section.type = type;
+	section.format = format;
+	section.count = count;
+	section.size = size;
+	section.nameLength = static_cast<std::uint32_t>(name.size());
+	section.stride = stride;
+	WriteBytes(stream, &section, sizeof(section));
+	WriteBytes(stream, name.data(), name.size());
+	WritePadding(stream, name.size());
+}
+
+void Snapshot::Write(const Scene &scene, std::ostream &stream) {
+	static_assert(sizeof(Header) % Alignment == 0 && sizeof(SectionHeader) % Alignment == 0, "Snapshot headers must keep sections aligned.");
+
+	// Ordinals number the Entities in index order, Components refer to their Entity by ordinal.
+	std::vector<std::uint32_t> ordinals(scene.entities.size(), std::numeric_limits<std::uint32_t>::max());
+	std::vector<std::uint32_t> flags;
+	std::vector<std::uint32_t> named;
+	std::uint64_t namesSize = 0;
+
+	for (std::size_t index = 0; index < scene.entities.size(); ++index) {
+		const auto &attributes = scene.entities[index];
+
+		if (attributes.entity.GetId() == Entity::NullId) {
+			continue;
+		}
+
+		ordinals[index] = static_cast<std::uint32_t>(flags.size());
+
+		if (attributes.name) {
+			named.emplace_back(static_cast<std::uint32_t>(index));
+			namesSize += 2 * sizeof(std::uint32_t) + attributes.name->size();
+		}
+
+		flags.emplace_back(attributes.enabled ? EnabledFlag : 0);
+	}
+
+	std::vector<std::pair<const Component::RegisteredType *, const ComponentPoolBase *>> pools;
+
+	for (std::size_t typeId = 0; typeId < scene.components.GetPools().size(); ++typeId) {
+		const auto pool = scene.components.GetPool(static_cast<TypeId>(typeId));
+
+		if (!pool || pool->GetSize() == 0 || pool->GetSnapshotFormat() == SnapshotFormat::None) {
+			continue;
+		}
+
+		if (auto type = Component::GetRegisteredType(static_cast<TypeId>(typeId))) {
+			pools.emplace_back(type, pool);
+		}
+	}
+
+	Header header = {};
+	std::memcpy(header.magic, Magic, sizeof(Magic));
+	header.version = Version;
+	header.byteOrder = ByteOrder;
+	header.entityCount = flags.size();
+	header.sectionCount = static_cast<std::uint32_t>(2 + pools.size());
+	WriteBytes(stream, &header, sizeof(header));
+
+	WriteSection(stream, SectionType::Entities, SnapshotFormat::None, flags.size(), flags.size() * sizeof(std::uint32_t));
+	WriteBytes(stream, flags.data(), flags.size() * sizeof(std::uint32_t));
+	WritePadding(stream, flags.size() * sizeof(std::uint32_t));
+
+	WriteSection(stream, SectionType::Names, SnapshotFormat::None, named.size(), namesSize);
+
+	for (const auto &index : named) {
+		const auto &name = *scene.entities[index].name;
+		const std::uint32_t record[2] = {ordinals[index], static_cast<std::uint32_t>(name.size())};
+		WriteBytes(stream, record, sizeof(record));
+		WriteBytes(stream, name.data(), name.size());
+	}
+
+	WritePadding(stream, namesSize);
+
+	std::vector<std::uint32_t> poolOrdinals;
+	std::string buffer;
+
+	for (const auto &[type, pool] : pools) {
+		const auto count = pool->GetSize();
+		const auto ordinalsSize = count * sizeof(std::uint32_t);
+		poolOrdinals.clear();
+
+		for (const auto &id : pool->GetEntities()) {
+			poolOrdinals.emplace_back(ordinals[Entity::GetIndex(id)]);
+		}
+
+		if (pool->GetSnapshotFormat() == SnapshotFormat::Plain) {
+			const auto stride = pool->GetSnapshotStride();
+			const auto size = Align(ordinalsSize) + count * stride;
+			WriteSection(stream, SectionType::Components, SnapshotFormat::Plain, count, size, type->name, static_cast<std::uint32_t>(stride));
+			WriteBytes(stream, poolOrdinals.data(), ordinalsSize);
+			WritePadding(stream, ordinalsSize);
+
+			// Records are copied out in blocks, so the whole section is never held in memory twice.
+			constexpr std::size_t blockSize = 1024;
+
+			for (std::size_t begin = 0; begin < count; begin += blockSize) {
+				const auto blockCount = std::min(blockSize, count - begin);
+				buffer.resize(blockCount * stride);
+				pool->SaveSnapshot(begin, blockCount, buffer.data());
+				WriteBytes(stream, buffer.data(), buffer.size());
+			}
+
+			WritePadding(stream, size);
+		} else {
+			// The size of each stream is only known once written.
+			buffer.clear();
+			std::ostringstream componentStream;
+
+			for (std::size_t i = 0; i < count; ++i) {
+				componentStream.str({});
+				pool->SaveSnapshot(i, componentStream);
+				const auto data = componentStream.str();
+				const auto length = static_cast<std::uint32_t>(data.size());
+				buffer.append(reinterpret_cast<const char *>(&length), sizeof(length));
+				buffer.append(data);
+			}
+
+			const auto size = Align(ordinalsSize) + buffer.size();
+			WriteSection(stream, SectionType::Components, SnapshotFormat::Stream, count, size, type->name);
+			WriteBytes(stream, poolOrdinals.data(), ordinalsSize);
+			WritePadding(stream, ordinalsSize);
+			WriteBytes(stream, buffer.data(), buffer.size());
+			WritePadding(stream, size);
+		}
+	}
+
+	if (!stream) {
+		throw std::runtime_error("Failed to write snapshot");
+	}
+}
+
+std::vector<Entity::Id> Snapshot::Read(Scene &scene, std::istream &stream) {
+	Reader reader(scene, stream);
+	reader.Read();
+	return reader.GetEntities();
+}
+
+void Snapshot::CheckHeader(const Header &header) {
+	if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0) {
+		throw std::runtime_error("Data is not a snapshot");
+	}
+
+	if (header.byteOrder != ByteOrder) {
+		throw std::runtime_error("Snapshot byte order does not match");
+	}
+
+	if (header.version != Version) {
+		throw std::runtime_error("Snapshot version is not supported");
+	}
+}
+
+void Snapshot::LoadEntities(Scene &scene, const std::uint32_t *flags, std::size_t count, std::vector<Entity::Id> &entities) {
+	const auto created = scene.CreateEntities(count);
+
+	for (std::size_t i = 0; i < count; ++i) {
+		if ((flags[i] & EnabledFlag) == 0) {
+			scene.DisableEntity(created[i].GetId());
+		}
+
+		entities.emplace_back(created[i].GetId());
+	}
+}
+
+void Snapshot::LoadName(Scene &scene, const std::vector<Entity::Id> &entities, std::uint32_t ordinal, std::string_view name) {
+	const auto id = GetEntity(entities, ordinal);
+	std::string entityName(name);
+
+	if (scene.names.find(entityName) != scene.names.end()) {
+		throw std::runtime_error("Entity name already in use");
+	}
+
+	scene.names[entityName] = id;
+	scene.entities[Entity::GetIndex(id)].name = std::move(entityName);
+}
+
+ComponentPoolBase *Snapshot::GetLoadPool(Scene &scene, const SectionHeader &header, std::string_view name, TypeId &typeId) {
+	const auto type = Component::GetRegisteredType(std::string(name));
+
+	if (!type) {
+		std::cerr << "Skipping unknown Component " << std::quoted(std::string(name)) << " in snapshot\n";
+		return nullptr;
+	}
+
+	auto &pool = scene.components.AssurePool(*type);
+
+	if (pool.GetSnapshotFormat() != header.format || pool.GetSnapshotStride() != header.stride) {
+		std::cerr << "Skipping Component " << std::quoted(type->name) << " in snapshot, its snapshot format has changed\n";
+		return nullptr;
+	}
+
+	typeId = type->typeId;
+	return &pool;
+}
+
+Entity::Id Snapshot::GetEntity(const std::vector<Entity::Id> &entities, std::uint32_t ordinal) {
+	if (ordinal >= entities.size()) {
+		throw std::runtime_error("Snapshot Entity ordinal is out of range");
+	}
+
+	return entities[ordinal];
+}
+
+void Snapshot::MarkComponent(Scene &scene, Entity::Id id, TypeId typeId) {
+	ComponentFilter::Mask added;
+	added.Set(typeId);
+	scene.components.MarkAdded(id, added);
+	scene.QueueAction(id, Scene::Action::Refresh);
+}
+
+Snapshot::Reader::Reader(Scene &scene, std::istream &stream) :
+	scene(scene),
+	stream(stream) {
+	ReadBytes(&header, sizeof(header));
+	CheckHeader(header);
+	entities.reserve(static_cast<std::size_t>(header.entityCount));
+}
+
+bool Snapshot::Reader::Read(std::size_t maxRecords) {
+	while (maxRecords != 0 && !IsDone()) {
+		if (!inSection) {
+			BeginSection();
+			continue;
+		}
+
+		const auto count = static_cast<std::size_t>(std::min<std::uint64_t>(section.count - position, maxRecords));
+
+		switch (section.type) {
+		case SectionType::Entities: {
+			std::vector<std::uint32_t> flags(count);
+			ReadBytes(flags.data(), count * sizeof(std::uint32_t));
+			LoadEntities(scene, flags.data(), count, entities);
+			break;
+		}
+		case SectionType::Names:
+			for (std::size_t i = 0; i < count; ++i) {
+				std::uint32_t record[2];
+				ReadBytes(record, sizeof(record));
+				buffer.resize(record[1]);
+				ReadBytes(buffer.data(), buffer.size());
+				LoadName(scene, entities, record[0], {buffer.data(), buffer.size()});
+			}
+
+			break;
+		case SectionType::Components:
+			if (section.format == SnapshotFormat::Plain) {
+				buffer.resize(count * section.stride);
+				ReadBytes(buffer.data(), buffer.size());
+
+				for (std::size_t i = 0; i < count; ++i) {
+					const auto id = GetEntity(entities, ordinals[position + i]);
+					pool->LoadSnapshot(id, buffer.data() + i * section.stride);
+					MarkComponent(scene, id, typeId);
+				}
+			} else {
+				for (std::size_t i = 0; i < count; ++i) {
+					std::uint32_t length;
+					ReadBytes(&length, sizeof(length));
+					buffer.resize(length);
+					ReadBytes(buffer.data(), buffer.size());
+
+					const auto id = GetEntity(entities, ordinals[position + i]);
+					StreamBuffer componentBuffer(buffer.data(), buffer.size());
+					std::istream componentStream(&componentBuffer);
+					pool->LoadSnapshot(id, componentStream);
+					MarkComponent(scene, id, typeId);
+				}
+			}
+
+			break;
+		default:
+			break;
+		}
+
+		position += count;
+		maxRecords -= count;
+
+		if (position == section.count) {
+			EndSection();
+		}
+	}
+
+	return !IsDone();
+}
+
+void Snapshot::Reader::BeginSection() {
+	ReadBytes(&section, sizeof(section));
+	buffer.resize(section.nameLength);
+	ReadBytes(buffer.data(), buffer.size());
+	Skip(Align(section.nameLength) - section.nameLength);
+
+	++nextSection;
+	inSection = true;
+	position = 0;
+	consumed = 0;
+	pool = nullptr;
+
+	if (section.type == SectionType::Components) {
+		pool = GetLoadPool(scene, section, {buffer.data(), buffer.size()}, typeId);
+
+		if (pool) {
+			ordinals.resize(static_cast<std::size_t>(section.count));
+			ReadBytes(ordinals.data(), ordinals.size() * sizeof(std::uint32_t));
+			Skip(Align(ordinals.size() * sizeof(std::uint32_t)) - ordinals.size() * sizeof(std::uint32_t));
+		}
+	}
+
+	// Unknown sections, and Components that are not loaded, are skipped whole.
+	if ((section.type == SectionType::Components && !pool) || section.type > SectionType::Components || section.count == 0) {
+		EndSection();
+	}
+}
+
+void Snapshot::Reader::EndSection() {
+	Skip(Align(section.size) - consumed);
+	inSection = false;
+}
+
+void Snapshot::Reader::ReadBytes(void *data, std::size_t size) {
+	if (!stream.read(static_cast<char *>(data), static_cast<std::streamsize>(size))) {
+		throw std::runtime_error("Snapshot ended unexpectedly");
+	}
+
+	// The header and section headers are read before the payload, and are not counted.
+	if (inSection) {
+		consumed += size;
+	}
+}
+
+void Snapshot::Reader::Skip(std::uint64_t size) {
+	if (size != 0 && !stream.ignore(static_cast<std::streamsize>(size))) {
+		throw std::runtime_error("Snapshot ended unexpectedly");
+	}
+
+	if (inSection) {
+		consumed += size;
+	}
+}
+
+Snapshot::View::View(const void *data, std::size_t size) {
+	const auto bytes = static_cast<const char *>(data);
+
+	if (reinterpret_cast<std::uintptr_t>(data) % Alignment != 0) {
+		throw std::runtime_error("Snapshot memory is not aligned");
+	}
+
+	if (size < sizeof(Header)) {
+		throw std::runtime_error("Snapshot ended unexpectedly");
+	}
+
+	std::memcpy(&header, bytes, sizeof(header));
+	CheckHeader(header);
+
+	std::uint64_t offset = sizeof(Header);
+
+	for (std::uint32_t i = 0; i < header.sectionCount; ++i) {
+		Section section;
+
+		if (size - offset < sizeof(SectionHeader)) {
+			throw std::runtime_error("Snapshot ended unexpectedly");
+		}
+
+		std::memcpy(&section.header, bytes + offset, sizeof(SectionHeader));
+		offset += sizeof(SectionHeader);
+
+		if (size - offset < Align(section.header.nameLength)) {
+			throw std::runtime_error("Snapshot ended unexpectedly");
+		}
+
+		section.name = {bytes + offset, section.header.nameLength};
+		offset += Align(section.header.nameLength);
+
+		if (size - offset < Align(section.header.size)) {
+			throw std::runtime_error("Snapshot ended unexpectedly");
+		}
+
+		section.payload = bytes + offset;
+		offset += Align(section.header.size);
+
+		if (section.header.type == SectionType::Components && section.header.format == SnapshotFormat::Plain &&
+			Align(section.header.count * sizeof(std::uint32_t)) + section.header.count * section.header.stride > section.header.size) {
+			throw std::runtime_error("Snapshot section is larger than its payload");
+		}
+
+		sections.emplace_back(section);
+	}
+}
+
+std::vector<Entity::Id> Snapshot::View::Load(Scene &scene) const {
+	std::vector<Entity::Id> entities;
+	entities.reserve(GetEntityCount());
+
+	for (const auto &section : sections) {
+		const auto count = static_cast<std::size_t>(section.header.count);
+		auto payload = section.payload;
+		const auto end = section.payload + section.header.size;
+
+		switch (section.header.type) {
+		case SectionType::Entities:
+			if (count * sizeof(std::uint32_t) > section.header.size) {
+				throw std::runtime_error("Snapshot section is larger than its payload");
+			}
+
+			LoadEntities(scene, reinterpret_cast<const std::uint32_t *>(payload), count, entities);
+			break;
+		case SectionType::Names:
+			for (std::size_t i = 0; i < count; ++i) {
+				std::uint32_t record[2];
+
+				if (static_cast<std::size_t>(end - payload) < sizeof(record)) {
+					throw std::runtime_error("Snapshot section is larger than its payload");
+				}
+
+				std::memcpy(record, payload, sizeof(record));
+				payload += sizeof(record);
+
+				if (static_cast<std::size_t>(end - payload) < record[1]) {
+					throw std::runtime_error("Snapshot section is larger than its payload");
+				}
+
+				LoadName(scene, entities, record[0], {payload, record[1]});
+				payload += record[1];
+			}
+
+			break;
+		case SectionType::Components: {
+			TypeId typeId;
+			const auto pool = GetLoadPool(scene, section.header, section.name, typeId);
+
+			if (!pool) {
+				break;
+			}
+
+			if (Align(count * sizeof(std::uint32_t)) > section.header.size) {
+				throw std::runtime_error("Snapshot section is larger than its payload");
+			}
+
+			const auto ordinals = reinterpret_cast<const std::uint32_t *>(payload);
+			payload += Align(count * sizeof(std::uint32_t));
+
+			for (std::size_t i = 0; i < count; ++i) {
+				const auto id = GetEntity(entities, ordinals[i]);
+
+				if (section.header.format == SnapshotFormat::Plain) {
+					pool->LoadSnapshot(id, payload);
+					payload += section.header.stride;
+				} else {
+					std::uint32_t length;
+
+					if (static_cast<std::size_t>(end - payload) < sizeof(length)) {
+						throw std::runtime_error("Snapshot section is larger than its payload");
+					}
+
+					std::memcpy(&length, payload, sizeof(length));
+					payload += sizeof(length);
+
+					if (static_cast<std::size_t>(end - payload) < length) {
+						throw std::runtime_error("Snapshot section is larger than its payload");
+					}
+
+					StreamBuffer componentBuffer(payload, length);
+					std::istream componentStream(&componentBuffer);
+					pool->LoadSnapshot(id, componentStream);
+					payload += length;
+				}
+
+				MarkComponent(scene, id, typeId);
+			}
+
+			break;
+		}
+		default:
+			break;
+		}
+	}
+
+	return entities;
+}
+
+bool Snapshot::View::IsEntityEnabled(std::uint32_t ordinal) const {
+	for (const auto &section : sections) {
+		if (section.header.type == SectionType::Entities && ordinal < section.header.count && ordinal < section.header.size / sizeof(std::uint32_t)) {
+			std::uint32_t flags;
+			std::memcpy(&flags, section.payload + ordinal * sizeof(std::uint32_t), sizeof(flags));
+			return (flags & EnabledFlag) != 0;
+		}
+	}
+
+	throw std::runtime_error("Snapshot Entity ordinal is out of range");
+}
+
+void Snapshot::View::ForEachComponent(std::uint32_t ordinal,
+	const std::function<void(const Component::RegisteredType &, const SectionHeader &, const char *, std::size_t)> &func) const {
+	for (const auto &section : sections) {
+		if (section.header.type != SectionType::Components) {
+			continue;
+		}
+
+		const auto type = Component::GetRegisteredType(std::string(section.name));
+		const auto count = static_cast<std::size_t>(section.header.count);
+
+		if (!type || Align(count * sizeof(std::uint32_t)) > section.header.size) {
+			continue;
+		}
+
+		const auto ordinals = reinterpret_cast<const std::uint32_t *>(section.payload);
+		auto payload = section.payload + Align(count * sizeof(std::uint32_t));
+		const auto end = section.payload + section.header.size;
+
+		for (std::size_t i = 0; i < count; ++i) {
+			std::size_t size = section.header.stride;
+
+			if (section.header.format == SnapshotFormat::Stream) {
+				std::uint32_t length;
+
+				if (static_cast<std::size_t>(end - payload) < sizeof(length)) {
+					throw std::runtime_error("Snapshot section is larger than its payload");
+				}
+
+				std::memcpy(&length, payload, sizeof(length));
+				payload += sizeof(length);
+				size = length;
+
+				if (static_cast<std::size_t>(end - payload) < size) {
+					throw std::runtime_error("Snapshot section is larger than its payload");
+				}
+			}
+
+			if (ordinals[i] == ordinal) {
+				func(*type, section.header, payload, size);
+				break;
+			}
+
+			payload += size;
+		}
+	}
+}
+
+const Snapshot::View::Section *Snapshot::View::FindSection(TypeId typeId) const {
+	const auto type = Component::GetRegisteredType(typeId);
+
+	if (!type) {
+		return nullptr;
+	}
+
+	for (const auto &section : sections) {
+		if (section.header.type == SectionType::Components && section.name == type->name) {
+			return &section;
+		}
+	}
+
+	return nullptr;
+}
+}
@@ -0,0 +1,326 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <limits>
+#include <streambuf>
+#include <string_view>
+#include <vector>
+
+#include "Entity.hpp"
+
+namespace acid {
+class Scene;
+
+/**
+ * @brief A versioned binary snapshot of the Entities of a Scene, with their names, enabled state and Components.
+ * Components are stored in one contiguous section per type, keyed by the name the type was registered with through
+ * Component::Registrar, types that are not registered or have no snapshot format are left out.
+ * Components with a plain record are stored as a packed array of records, copied as is when loading,
+ * or used in place from a snapshot in memory through View.
+ *
+ * Values are in the byte order of the machine that wrote the snapshot, sections start on multiples of Alignment.
+ * Entities are referred to by ordinal, their position in the Entities section, and get new IDs when loaded.
+ */
+class ACID_EXPORT Snapshot {
+public:
+	/// The format version, snapshots of another version are rejected.
+	static constexpr std::uint32_t Version = 1;
+
+	/// Alignment of the headers, names and payloads within a snapshot.
+	static constexpr std::size_t Alignment = 16;
+
+	/// Entity flag set when the Entity is enabled.
+	static constexpr std::uint32_t EnabledFlag = 1;
+
+	enum class SectionType : std::uint32_t {
+		/// The 32 bit flags of each Entity.
+		Entities = 1,
+		/// The 32 bit ordinal and name length of each named Entity, followed by the name.
+		Names,
+		/// The 32 bit ordinals of the Entities owning the Components, then the packed plain records, or for each Component its size and stream.
+		Components
+	};
+
+	class Header {
+	public:
+		char magic[8];
+		std::uint32_t version;
+		/// Written as 0x01020304, to detect a snapshot written with another byte order.
+		std::uint32_t byteOrder;
+		std::uint64_t entityCount;
+		std::uint32_t sectionCount;
+		std::uint32_t reserved;
+	};
+
+	class SectionHeader {
+	public:
+		SectionType type;
+		SnapshotFormat format;
+		/// Number of Entities, names or Components.
+		std::uint64_t count;
+		/// Size of the payload in bytes, without its padding.
+		std::uint64_t size;
+		/// Length of the name following the header, the registered Component name.
+		std::uint32_t nameLength;
+		/// Size of a plain record, 0 for other formats.
+		std::uint32_t stride;
+	};
+
+	/**
+	 * @brief Reads the stream of a Component straight from snapshot memory.
+	 */
+	class StreamBuffer : public std::streambuf {
+	public:
+		StreamBuffer(const char *data, std::size_t size) {
+			auto begin = const_cast<char *>(data);
+			setg(begin, begin, begin + size);
+		}
+	};
+
+	/**
+	 * @brief Loads a snapshot from a stream in steps, so a large snapshot can be loaded over several frames.
+	 * Entities exist once the Entities section has been read, and get their Components as their sections are read.
+	 * As with any added Component, Systems see them from the next Scene update.
+	 */
+	class ACID_EXPORT Reader {
+	public:
+		/**
+		 * Creates a reader, reading and checking the snapshot header.
+		 * @param scene The Scene loaded into.
+		 * @param stream The stream, read from as records are loaded.
+		 */
+		Reader(Scene &scene, std::istream &stream);
+
+		/**
+		 * Reads the next records of the snapshot into the Scene.
+		 * @param maxRecords The maximum number of Entities, names and Components to read.
+		 * @return If records are left to read.
+		 */
+		bool Read(std::size_t maxRecords = std::numeric_limits<std::size_t>::max());
+
+		/**
+		 * Gets if the whole snapshot has been read.
+		 * @return If the snapshot has been read.
+		 */
+		bool IsDone() const noexcept { return !inSection && nextSection == header.sectionCount; }
+
+		/**
+		 * Gets the Entities loaded so far.
+		 * @return The Entity IDs, the index of this array is the Entity ordinal.
+		 */
+		const std::vector<Entity::Id> &GetEntities() const noexcept { return entities; }
+
+	private:
+		/**
+		 * Reads a section header and name, and the ordinals of a Components section.
+		 */
+		void BeginSection();
+
+		/**
+		 * Reads the remaining payload and padding of the current section.
+		 */
+		void EndSection();
+
+		void ReadBytes(void *data, std::size_t size);
+		void Skip(std::uint64_t size);
+
+		Scene &scene;
+		std::istream &stream;
+		Header header;
+		SectionHeader section;
+
+		/// Index of the next section to begin.
+		std::uint32_t nextSection = 0;
+		bool inSection = false;
+
+		/// Records of the current section read.
+		std::uint64_t position = 0;
+		/// Bytes of the current section payload read.
+		std::uint64_t consumed = 0;
+
+		/// The pool Components of the current section are loaded into, nullptr if the section is skipped.
+		ComponentPoolBase *pool = nullptr;
+		TypeId typeId = 0;
+
+		/// Ordinals of the Entities owning the Components of the current section.
+		std::vector<std::uint32_t> ordinals;
+		std::vector<Entity::Id> entities;
+		std::vector<char> buffer;
+	};
+
+	/**
+	 * @brief Reads a snapshot held in memory, such as a memory mapped file, without copying it.
+	 */
+	class ACID_EXPORT View {
+	public:
+		/**
+		 * Creates a view, checking the snapshot header and the bounds of every section.
+		 * @param data The snapshot, aligned to Alignment, it must outlive the view.
+		 * @param size The snapshot size in bytes.
+		 */
+		View(const void *data, std::size_t size);
+
+		/**
+		 * Gets the number of Entities in the snapshot.
+		 * @return The number of Entities.
+		 */
+		std::size_t GetEntityCount() const noexcept { return static_cast<std::size_t>(header.entityCount); }
+
+		/**
+		 * Gets the number of Components of a type in the snapshot.
+		 * @tparam T The Component type.
+		 * @return The number of Components.
+		 */
+		template<typename T>
+		std::size_t GetComponentCount() const {
+			auto section = FindSection(GetComponentTypeId<T>());
+			return section ? static_cast<std::size_t>(section->header.count) : 0;
+		}
+
+		/**
+		 * Gets the ordinals of the Entities owning the Components of a type.
+		 * @tparam T The Component type.
+		 * @return GetComponentCount ordinals, or nullptr if the snapshot has no Component of this type.
+		 */
+		template<typename T>
+		const std::uint32_t *GetOrdinals() const {
+			auto section = FindSection(GetComponentTypeId<T>());
+			return section ? reinterpret_cast<const std::uint32_t *>(section->payload) : nullptr;
+		}
+
+		/**
+		 * Gets the plain records of the Components of a type, in place.
+		 * @tparam T The Component type, with a plain snapshot record.
+		 * @return GetComponentCount records in the order of GetOrdinals, or nullptr if the snapshot has no records of this type with the same size.
+		 */
+		template<typename T>
+		const typename T::SnapshotData *GetRecords() const {
+			static_assert(acid::GetSnapshotFormat<T>() == SnapshotFormat::Plain, "T must have a plain snapshot record.");
+			static_assert(alignof(typename T::SnapshotData) <= Alignment, "T snapshot record is over aligned.");
+
+			auto section = FindSection(GetComponentTypeId<T>());
+
+			if (!section || section->header.format != SnapshotFormat::Plain || section->header.stride != sizeof(typename T::SnapshotData)) {
+				return nullptr;
+			}
+
+			return reinterpret_cast<const typename T::SnapshotData *>(section->payload + Align(section->header.count * sizeof(std::uint32_t)));
+		}
+
+		/**
+		 * Gets if an Entity of the snapshot is enabled.
+		 * @param ordinal The Entity ordinal.
+		 * @return If the Entity is enabled.
+		 */
+		bool IsEntityEnabled(std::uint32_t ordinal) const;
+
+		/**
+		 * Gets the Components of an Entity of the snapshot whose type is registered.
+		 * @param ordinal The Entity ordinal.
+		 * @param func Called with the registered type, the section header and the bytes of the plain record or stream of each Component.
+		 */
+		void ForEachComponent(std::uint32_t ordinal,
+			const std::function<void(const Component::RegisteredType &, const SectionHeader &, const char *, std::size_t)> &func) const;
+
+		/**
+		 * Loads the snapshot into the Scene.
+		 * @param scene The Scene.
+		 * @return The created Entity IDs, the index of this array is the Entity ordinal.
+		 */
+		std::vector<Entity::Id> Load(Scene &scene) const;
+
+	private:
+		class Section {
+		public:
+			SectionHeader header;
+			std::string_view name;
+			const char *payload;
+		};
+
+		/**
+		 * Finds the Components section of a registered type.
+		 * @param typeId The Component type ID.
+		 * @return The section, or nullptr if the type is not registered or not in the snapshot.
+		 */
+		const Section *FindSection(TypeId typeId) const;
+
+		Header header;
+		std::vector<Section> sections;
+	};
+
+	/**
+	 * Writes a snapshot of the Scene. Actions queued since the last update are not written, nor are commands recorded since.
+	 * @param scene The Scene.
+	 * @param stream The stream.
+	 */
+	static void Write(const Scene &scene, std::ostream &stream);
+
+	/**
+	 * Reads a whole snapshot into the Scene.
+	 * @param scene The Scene.
+	 * @param stream The stream.
+	 * @return The created Entity IDs, the index of this array is the Entity ordinal.
+	 */
+	static std::vector<Entity::Id> Read(Scene &scene, std::istream &stream);
+
+	/**
+	 * Rounds a size up to the snapshot alignment.
+	 * @param size The size in bytes.
+	 * @return The aligned size.
+	 */
+	static constexpr std::uint64_t Align(std::uint64_t size) noexcept { return (size + Alignment - 1) & ~static_cast<std::uint64_t>(Alignment - 1); }
+
+private:
+	/**
+	 * Checks a snapshot header.
+	 * @param header The header.
+	 */
+	static void CheckHeader(const Header &header);
+
+	/**
+	 * Creates Entities from their flags.
+	 * @param scene The Scene.
+	 * @param flags The Entity flags.
+	 * @param count The number of Entities.
+	 * @param entities The created Entity IDs are appended to this array.
+	 */
+	static void LoadEntities(Scene &scene, const std::uint32_t *flags, std::size_t count, std::vector<Entity::Id> &entities);
+
+	/**
+	 * Names an Entity.
+	 * @param scene The Scene.
+	 * @param entities The loaded Entity IDs.
+	 * @param ordinal The Entity ordinal.
+	 * @param name The Entity name.
+	 */
+	static void LoadName(Scene &scene, const std::vector<Entity::Id> &entities, std::uint32_t ordinal, std::string_view name);
+
+	/**
+	 * Gets the pool Components of a section are loaded into.
+	 * @param scene The Scene.
+	 * @param header The section header.
+	 * @param name The section name.
+	 * @param typeId The Component type ID is written to this value.
+	 * @return The Component pool, or nullptr if the Components are skipped.
+	 */
+	static ComponentPoolBase *GetLoadPool(Scene &scene, const SectionHeader &header, std::string_view name, TypeId &typeId);
+
+	/**
+	 * Gets a loaded Entity by ordinal.
+	 * @param entities The loaded Entity IDs.
+	 * @param ordinal The Entity ordinal.
+	 * @return The Entity ID.
+	 */
+	static Entity::Id GetEntity(const std::vector<Entity::Id> &entities, std::uint32_t ordinal);
+
+	/**
+	 * Marks an Entity as having a loaded Component, so it is matched against the Systems again.
+	 * @param scene The Scene.
+	 * @param id The Entity ID.
+	 * @param typeId The Component type ID.
+	 */
+	static void MarkComponent(Scene &scene, Entity::Id id, TypeId typeId);
+};
+}
@@ -0,0 +1,453 @@
+#include "SpatialGrid.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace acid {
+namespace {
+/// Smallest number of Entities or queries given to a task.
+constexpr std::size_t BuildGrainSize = 4096;
+constexpr std::size_t QueryGrainSize = 64;
+
+/**
+ * Splits a range into chunks, run on the thread pool if there is one and more than one chunk.
+ * @tparam Func The function type.
+ * @param threadPool The thread pool, or nullptr.
+ * @param count The size of the range.
+ * @param grainSize The smallest chunk size.
+ * @param func The function, taking the chunk begin, end and index.
+ * @return The number of chunks.
+ */
+template<typename Func>
+std::size_t ForEachChunk(ThreadPool *threadPool, std::size_t count, std::size_t grainSize, Func &&func) {
+	if (threadPool && threadPool->GetThreadCount() > 1) {
+		grainSize = std::max(grainSize, count / (threadPool->GetThreadCount() * 4) + 1);
+	} else {
+		grainSize = std::max<std::size_t>(count, 1);
+	}
+
+	const auto chunkCount = (count + grainSize - 1) / grainSize;
+
+	if (chunkCount <= 1) {
+		if (count != 0) {
+			func(0, count, 0);
+		}
+
+		return chunkCount;
+	}
+
+	ThreadPool::TaskGroup group;
+
+	for (std::size_t chunk = 0; chunk < chunkCount; ++chunk) {
+		const auto begin = chunk * grainSize;
+		const auto end = std::min(begin + grainSize, count);
+		threadPool->Run(group, [&func, begin, end, chunk] {
+			func(begin, end, chunk);
+		});
+	}
+
+	threadPool->Wait(group);
+	return chunkCount;
+}
+
+/**
+ * Gets the chunk count ForEachChunk will use.
+ */
+std::size_t GetChunkCount(ThreadPool *threadPool, std::size_t count, std::size_t grainSize) {
+	if (!threadPool || threadPool->GetThreadCount() <= 1) {
+		return count != 0 ? 1 : 0;
+	}
+
+	grainSize = std::max(grainSize, count / (threadPool->GetThreadCount() * 4) + 1);
+	return (count + grainSize - 1) / grainSize;
+}
+
+/// Bucket of the Entities kept out of the cells.
+constexpr std::uint32_t NullBucket = std::numeric_limits<std::uint32_t>::max();
+
+std::size_t GetCellCount(std::int32_t min, std::int32_t max) noexcept {
+	return static_cast<std::size_t>(static_cast<std::int64_t>(max) - min + 1);
+}
+
+float Clamp(float value, float min, float max) noexcept {
+	return std::min(std::max(value, min), max);
+}
+
+std::int32_t ToCell(float coordinate) noexcept {
+	// Far coordinates are clamped, so they share the border cells instead of overflowing.
+	constexpr auto limit = static_cast<float>(1 << 30);
+
+	if (!(coordinate > -limit)) {
+		return -(1 << 30);
+	}
+
+	return static_cast<std::int32_t>(std::floor(std::min(coordinate, limit)));
+}
+}
+
+SpatialGrid::SpatialGrid(float cellSize) :
+	cellSize(cellSize),
+	inverseCellSize(1.0f / cellSize) {
+	if (!(cellSize > 0.0f) || !std::isfinite(inverseCellSize)) {
+		throw std::runtime_error("Spatial grid cell size must be positive");
+	}
+}
+
+void SpatialGrid::Build(const Entity::Id *ids, const Sphere *bounds, std::size_t count, ThreadPool *threadPool) {
+	if (count >= std::numeric_limits<std::uint32_t>::max()) {
+		throw std::runtime_error("Spatial grid cannot store that many Entities");
+	}
+
+	this->ids.assign(ids, ids + count);
+	this->bounds.assign(bounds, bounds + count);
+	cells.resize(count);
+	entryBuckets.resize(count);
+	oversized.clear();
+
+	// One bucket or more per Entity keeps buckets short.
+	bucketCount = 1;
+
+	while (bucketCount < count) {
+		bucketCount <<= 1;
+	}
+
+	if (bucketCount + 1 > bucketCapacity) {
+		bucketCapacity = bucketCount + 1;
+		bucketStarts = std::make_unique<std::atomic<std::uint32_t>[]>(bucketCapacity);
+	}
+
+	for (std::size_t i = 0; i <= bucketCount; ++i) {
+		bucketStarts[i].store(0, std::memory_order_relaxed);
+	}
+
+	// Counting sort of the Entities by bucket, counts are atomic only when chunks run concurrently.
+	const auto chunkCount = GetChunkCount(threadPool, count, BuildGrainSize);
+	const auto concurrent = chunkCount > 1;
+	std::vector<float> chunkMargins(chunkCount);
+	std::vector<std::vector<std::uint32_t>> chunkOversized(chunkCount);
+
+	ForEachChunk(threadPool, count, BuildGrainSize, [&](std::size_t begin, std::size_t end, std::size_t chunk) {
+		auto chunkMargin = 0.0f;
+
+		for (auto i = begin; i < end; ++i) {
+			const auto &sphere = bounds[i];
+			const auto radius = std::abs(sphere.radius);
+
+			if (!(radius <= cellSize)) {
+				chunkOversized[chunk].emplace_back(static_cast<std::uint32_t>(i));
+				entryBuckets[i] = NullBucket;
+				continue;
+			}
+
+			chunkMargin = std::max(chunkMargin, radius);
+			cells[i] = GetCell(sphere.center);
+			const auto bucket = GetBucket(cells[i]);
+			entryBuckets[i] = static_cast<std::uint32_t>(bucket);
+			auto &counter = bucketStarts[bucket + 1];
+
+			if (concurrent) {
+				counter.fetch_add(1, std::memory_order_relaxed);
+			} else {
+				counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			}
+		}
+
+		chunkMargins[chunk] = chunkMargin;
+	});
+
+	margin = 0.0f;
+
+	for (std::size_t chunk = 0; chunk < chunkCount; ++chunk) {
+		margin = std::max(margin, chunkMargins[chunk]);
+		oversized.insert(oversized.end(), chunkOversized[chunk].begin(), chunkOversized[chunk].end());
+	}
+
+	for (std::size_t i = 1; i <= bucketCount; ++i) {
+		bucketStarts[i].store(bucketStarts[i].load(std::memory_order_relaxed) + bucketStarts[i - 1].load(std::memory_order_relaxed),
+			std::memory_order_relaxed);
+	}
+
+	// Each bucket start is used as its insertion cursor, it ends up at the start of the next bucket.
+	entries.resize(count - oversized.size());
+
+	ForEachChunk(threadPool, count, BuildGrainSize, [&](std::size_t begin, std::size_t end, std::size_t) {
+		for (auto i = begin; i < end; ++i) {
+			if (entryBuckets[i] == NullBucket) {
+				continue;
+			}
+
+			auto &cursor = bucketStarts[entryBuckets[i]];
+			std::uint32_t position;
+
+			if (concurrent) {
+				position = cursor.fetch_add(1, std::memory_order_relaxed);
+			} else {
+				position = cursor.load(std::memory_order_relaxed);
+				cursor.store(position + 1, std::memory_order_relaxed);
+			}
+
+			entries[position] = static_cast<std::uint32_t>(i);
+		}
+	});
+
+	for (auto i = bucketCount; i > 0; --i) {
+		bucketStarts[i].store(bucketStarts[i - 1].load(std::memory_order_relaxed), std::memory_order_relaxed);
+	}
+
+	bucketStarts[0].store(0, std::memory_order_relaxed);
+
+	// Concurrent chunks insert in any order, sorting the buckets gives the same grid as a serial build.
+	if (concurrent) {
+		ForEachChunk(threadPool, bucketCount, BuildGrainSize, [&](std::size_t begin, std::size_t end, std::size_t) {
+			for (auto bucket = begin; bucket < end; ++bucket) {
+				const auto first = bucketStarts[bucket].load(std::memory_order_relaxed);
+				const auto last = bucketStarts[bucket + 1].load(std::memory_order_relaxed);
+
+				if (last - first > 1) {
+					std::sort(entries.begin() + first, entries.begin() + last);
+				}
+			}
+		});
+	}
+}
+
+void SpatialGrid::Query(const Sphere *queries, std::size_t count, Results &results, ThreadPool *threadPool) const {
+	RunQueries(count, results, threadPool, [this, queries](std::size_t query, std::vector<Entity::Id> &found, auto &) {
+		const auto &sphere = queries[query];
+		const auto radius = std::abs(sphere.radius);
+
+		ForEachEntry({sphere.center.x - radius, sphere.center.y - radius, sphere.center.z - radius},
+			{sphere.center.x + radius, sphere.center.y + radius, sphere.center.z + radius}, [&](std::uint32_t entry) {
+			const auto &other = bounds[entry];
+			const auto dx = other.center.x - sphere.center.x;
+			const auto dy = other.center.y - sphere.center.y;
+			const auto dz = other.center.z - sphere.center.z;
+			const auto distance = radius + std::abs(other.radius);
+
+			if (dx * dx + dy * dy + dz * dz <= distance * distance) {
+				found.emplace_back(ids[entry]);
+			}
+		});
+	});
+}
+
+void SpatialGrid::Query(const Box *queries, std::size_t count, Results &results, ThreadPool *threadPool) const {
+	RunQueries(count, results, threadPool, [this, queries](std::size_t query, std::vector<Entity::Id> &found, auto &) {
+		const auto &box = queries[query];
+
+		if (box.min.x > box.max.x || box.min.y > box.max.y || box.min.z > box.max.z) {
+			return;
+		}
+
+		ForEachEntry(box.min, box.max, [&](std::uint32_t entry) {
+			// Distance from the sphere center to the closest point of the box.
+			const auto &other = bounds[entry];
+			const auto dx = Clamp(other.center.x, box.min.x, box.max.x) - other.center.x;
+			const auto dy = Clamp(other.center.y, box.min.y, box.max.y) - other.center.y;
+			const auto dz = Clamp(other.center.z, box.min.z, box.max.z) - other.center.z;
+
+			if (dx * dx + dy * dy + dz * dz <= other.radius * other.radius) {
+				found.emplace_back(ids[entry]);
+			}
+		});
+	});
+}
+
+void SpatialGrid::Query(const Ray *queries, std::size_t count, Results &results, ThreadPool *threadPool) const {
+	RunQueries(count, results, threadPool, [this, queries](std::size_t query, std::vector<Entity::Id> &found, auto &hits) {
+		const auto &ray = queries[query];
+		hits.clear();
+
+		const auto test = [&](std::uint32_t entry) {
+			// Nearest intersection with the sphere, 0 when the ray starts inside it.
+			const auto &other = bounds[entry];
+			const auto mx = ray.origin.x - other.center.x;
+			const auto my = ray.origin.y - other.center.y;
+			const auto mz = ray.origin.z - other.center.z;
+			const auto b = mx * ray.direction.x + my * ray.direction.y + mz * ray.direction.z;
+			const auto c = mx * mx + my * my + mz * mz - other.radius * other.radius;
+
+			if (c > 0.0f && b > 0.0f) {
+				return;
+			}
+
+			const auto discriminant = b * b - c;
+
+			if (discriminant < 0.0f) {
+				return;
+			}
+
+			const auto distance = std::max(-b - std::sqrt(discriminant), 0.0f);
+
+			if (distance <= ray.length) {
+				hits.emplace_back(distance, entry);
+			}
+		};
+
+		// Entities are stored in the cell of their center, within one cell of the cells the ray crosses.
+		const auto reach = margin > 0.0f ? 1 : 0;
+		const auto stepCount = static_cast<std::size_t>(std::min(std::max(ray.length, 0.0f) * inverseCellSize, 1e9f)) * 3 + 3;
+
+		if (stepCount * (reach != 0 ? 27 : 1) > ids.size()) {
+			// Long rays test every Entity.
+			for (std::uint32_t entry = 0; entry < ids.size(); ++entry) {
+				test(entry);
+			}
+		} else {
+			// Walks the cells along the ray, an Entity near several of them is hit several times.
+			const float origin[3] = {ray.origin.x * inverseCellSize, ray.origin.y * inverseCellSize, ray.origin.z * inverseCellSize};
+			const float direction[3] = {ray.direction.x, ray.direction.y, ray.direction.z};
+			std::int32_t cell[3], step[3];
+			float next[3], delta[3];
+
+			for (std::size_t axis = 0; axis < 3; ++axis) {
+				cell[axis] = ToCell(origin[axis]);
+
+				if (direction[axis] > 0.0f) {
+					step[axis] = 1;
+					delta[axis] = cellSize / direction[axis];
+					next[axis] = (static_cast<float>(cell[axis]) + 1.0f - origin[axis]) * delta[axis];
+				} else if (direction[axis] < 0.0f) {
+					step[axis] = -1;
+					delta[axis] = -cellSize / direction[axis];
+					next[axis] = (origin[axis] - static_cast<float>(cell[axis])) * delta[axis];
+				} else {
+					step[axis] = 0;
+					delta[axis] = std::numeric_limits<float>::infinity();
+					next[axis] = std::numeric_limits<float>::infinity();
+				}
+			}
+
+			for (std::size_t visited = 0; visited < stepCount; ++visited) {
+				for (auto z = cell[2] - reach; z <= cell[2] + reach; ++z) {
+					for (auto y = cell[1] - reach; y <= cell[1] + reach; ++y) {
+						for (auto x = cell[0] - reach; x <= cell[0] + reach; ++x) {
+							ForEachInCell({x, y, z}, test);
+						}
+					}
+				}
+
+				const auto axis = next[0] < next[1] ? (next[0] < next[2] ? 0 : 2) : (next[1] < next[2] ? 1 : 2);
+
+				if (next[axis] > ray.length) {
+					break;
+				}
+
+				cell[axis] += step[axis];
+				next[axis] += delta[axis];
+			}
+
+			for (const auto &entry : oversized) {
+				test(entry);
+			}
+		}
+
+		std::sort(hits.begin(), hits.end());
+		hits.erase(std::unique(hits.begin(), hits.end()), hits.end());
+
+		for (const auto &[distance, entry] : hits) {
+			found.emplace_back(ids[entry]);
+		}
+	});
+}
+
+template<typename Func>
+void SpatialGrid::RunQueries(std::size_t count, Results &results, ThreadPool *threadPool, Func &&func) const {
+	class Chunk {
+	public:
+		std::vector<std::size_t> counts;
+		std::vector<Entity::Id> found;
+		std::vector<std::pair<float, std::uint32_t>> hits;
+	};
+
+	const auto chunkCount = GetChunkCount(threadPool, count, QueryGrainSize);
+	std::vector<Chunk> chunks(chunkCount);
+
+	ForEachChunk(threadPool, count, QueryGrainSize, [&](std::size_t begin, std::size_t end, std::size_t index) {
+		auto &chunk = chunks[index];
+		chunk.counts.reserve(end - begin);
+
+		for (auto query = begin; query < end; ++query) {
+			const auto size = chunk.found.size();
+			func(query, chunk.found, chunk.hits);
+			chunk.counts.emplace_back(chunk.found.size() - size);
+		}
+	});
+
+	// Chunks are concatenated in query order.
+	results.offsets.resize(count + 1);
+	results.offsets[0] = 0;
+	results.entities.clear();
+	std::size_t query = 0;
+
+	for (const auto &chunk : chunks) {
+		results.entities.insert(results.entities.end(), chunk.found.begin(), chunk.found.end());
+
+		for (const auto &found : chunk.counts) {
+			results.offsets[query + 1] = results.offsets[query] + found;
+			++query;
+		}
+	}
+}
+
+template<typename Func>
+void SpatialGrid::ForEachEntry(const Vector &min, const Vector &max, Func &&func) const {
+	const auto range = GetCellRange({min.x - margin, min.y - margin, min.z - margin}, {max.x + margin, max.y + margin, max.z + margin});
+	const auto cellCount = GetCellCount(range.min.x, range.max.x) * GetCellCount(range.min.y, range.max.y) *
+		GetCellCount(range.min.z, range.max.z);
+
+	// Queries covering more cells than there are Entities test every Entity.
+	if (cellCount > ids.size()) {
+		for (std::uint32_t entry = 0; entry < ids.size(); ++entry) {
+			func(entry);
+		}
+
+		return;
+	}
+
+	for (auto z = range.min.z; z <= range.max.z; ++z) {
+		for (auto y = range.min.y; y <= range.max.y; ++y) {
+			for (auto x = range.min.x; x <= range.max.x; ++x) {
+				ForEachInCell({x, y, z}, func);
+			}
+		}
+	}
+
+	for (const auto &entry : oversized) {
+		func(entry);
+	}
+}
+
+template<typename Func>
+void SpatialGrid::ForEachInCell(const Cell &cell, Func &&func) const {
+	const auto bucket = GetBucket(cell);
+	const auto first = bucketStarts[bucket].load(std::memory_order_relaxed);
+	const auto last = bucketStarts[bucket + 1].load(std::memory_order_relaxed);
+
+	// Buckets also hold the Entities of other cells.
+	for (auto position = first; position < last; ++position) {
+		const auto entry = entries[position];
+		const auto &other = cells[entry];
+
+		if (other.x == cell.x && other.y == cell.y && other.z == cell.z) {
+			func(entry);
+		}
+	}
+}
+
+SpatialGrid::Cell SpatialGrid::GetCell(const Vector &position) const noexcept {
+	return {ToCell(position.x * inverseCellSize), ToCell(position.y * inverseCellSize), ToCell(position.z * inverseCellSize)};
+}
+
+SpatialGrid::CellRange SpatialGrid::GetCellRange(const Vector &min, const Vector &max) const noexcept {
+	return {GetCell(min), GetCell(max)};
+}
+
+std::size_t SpatialGrid::GetBucket(const Cell &cell) const noexcept {
+	const auto hash = (static_cast<std::uint32_t>(cell.x) * 73856093u) ^ (static_cast<std::uint32_t>(cell.y) * 19349663u) ^
+		(static_cast<std::uint32_t>(cell.z) * 83492791u);
+	return hash & (bucketCount - 1);
+}
+}
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "Utils/NonCopyable.hpp"
+#include "Utils/ThreadPool.hpp"
+#include "Entity.hpp"
+
+namespace acid {
+/**
+ * @brief A uniform grid of Entity bounding spheres for neighbour queries. Each Entity is stored in the cell of its center,
+ * and queries are grown by the largest stored radius. Grid cells are hashed into buckets, so the grid is unbounded
+ * and its memory scales with the Entities, not with the space they cover.
+ * The grid is rebuilt as a whole, with a counting sort of the Entities into buckets that can run on a thread pool.
+ * Queries are batched, they only read the grid and can run concurrently.
+ */
+class ACID_EXPORT SpatialGrid : public NonCopyable {
+public:
+	class Vector {
+	public:
+		float x = 0.0f, y = 0.0f, z = 0.0f;
+	};
+
+	class Sphere {
+	public:
+		Vector center;
+		float radius = 0.0f;
+	};
+
+	class Box {
+	public:
+		Vector min;
+		Vector max;
+	};
+
+	class Ray {
+	public:
+		Vector origin;
+		/// Normalized direction.
+		Vector direction;
+		/// Distance along the direction the ray stops at.
+		float length = 0.0f;
+	};
+
+	/**
+	 * @brief The Entities found by a batch of queries, grouped by query.
+	 */
+	class Results {
+		friend class SpatialGrid;
+	public:
+		/**
+		 * Gets the number of queries.
+		 * @return The number of queries.
+		 */
+		std::size_t GetQueryCount() const noexcept { return offsets.empty() ? 0 : offsets.size() - 1; }
+
+		/**
+		 * Gets the number of Entities found by a query.
+		 * @param query The query index.
+		 * @return The number of Entities.
+		 */
+		std::size_t GetCount(std::size_t query) const noexcept { return offsets[query + 1] - offsets[query]; }
+
+		/**
+		 * Gets the Entities found by a query.
+		 * @param query The query index.
+		 * @return GetCount Entity IDs.
+		 */
+		const Entity::Id *GetEntities(std::size_t query) const noexcept { return entities.data() + offsets[query]; }
+
+	private:
+		/// Start of the Entities of each query, followed by the end of the last one.
+		std::vector<std::size_t> offsets;
+		std::vector<Entity::Id> entities;
+	};
+
+	/**
+	 * Creates a new grid. Entities with a radius larger than the cell size are kept out of the cells and tested by every query.
+	 * @param cellSize The size of the cells, around the diameter of the common Entity is a good start.
+	 */
+	explicit SpatialGrid(float cellSize);
+
+	/**
+	 * Rebuilds the grid.
+	 * @param ids The Entity IDs.
+	 * @param bounds The bounding sphere of each Entity.
+	 * @param count The number of Entities.
+	 * @param threadPool The thread pool the grid is built on, or nullptr to build it on the calling thread.
+	 */
+	void Build(const Entity::Id *ids, const Sphere *bounds, std::size_t count, ThreadPool *threadPool = nullptr);
+
+	/**
+	 * Finds the Entities whose bounds intersect spheres.
+	 * @param queries The spheres.
+	 * @param count The number of spheres.
+	 * @param results The Entities found by each sphere, in no particular order.
+	 * @param threadPool The thread pool the queries are split over, or nullptr to run them on the calling thread.
+	 */
+	void Query(const Sphere *queries, std::size_t count, Results &results, ThreadPool *threadPool = nullptr) const;
+
+	/**
+	 * Finds the Entities whose bounds intersect boxes.
+	 * @param queries The boxes.
+	 * @param count The number of boxes.
+	 * @param results The Entities found by each box, in no particular order.
+	 * @param threadPool The thread pool the queries are split over, or nullptr to run them on the calling thread.
+	 */
+	void Query(const Box *queries, std::size_t count, Results &results, ThreadPool *threadPool = nullptr) const;
+
+	/**
+	 * Finds the Entities whose bounds are hit by rays.
+	 * @param queries The rays.
+	 * @param count The number of rays.
+	 * @param results The Entities hit by each ray, nearest first.
+	 * @param threadPool The thread pool the queries are split over, or nullptr to run them on the calling thread.
+	 */
+	void Query(const Ray *queries, std::size_t count, Results &results, ThreadPool *threadPool = nullptr) const;
+
+	/**
+	 * Gets the size of the cells.
+	 * @return The cell size.
+	 */
+	float GetCellSize() const noexcept { return cellSize; }
+
+	/**
+	 * Gets the number of Entities in the grid.
+	 * @return The number of Entities.
+	 */
+	std::size_t GetSize() const noexcept { return ids.size(); }
+
+private:
+	class Cell {
+	public:
+		std::int32_t x, y, z;
+	};
+
+	/**
+	 * @brief A range of cells, bounds included.
+	 */
+	class CellRange {
+	public:
+		Cell min;
+		Cell max;
+	};
+
+	/**
+	 * Runs the queries of a batch, in chunks on the thread pool if there is one.
+	 * @tparam Func The function type, appending the Entities found by a query to a list.
+	 * @param count The number of queries.
+	 * @param results The results.
+	 * @param threadPool The thread pool, or nullptr.
+	 * @param func The function, taking the query index and the list.
+	 */
+	template<typename Func>
+	void RunQueries(std::size_t count, Results &results, ThreadPool *threadPool, Func &&func) const;
+
+	/**
+	 * Visits the Entities that may intersect a box, those stored in the cells the box covers once grown by the largest radius,
+	 * and the Entities kept out of the cells.
+	 * @tparam Func The function type.
+	 * @param min The box min.
+	 * @param max The box max.
+	 * @param func The function, taking the Entity index in the grid.
+	 */
+	template<typename Func>
+	void ForEachEntry(const Vector &min, const Vector &max, Func &&func) const;
+
+	/**
+	 * Visits the Entities stored in a cell.
+	 * @tparam Func The function type.
+	 * @param cell The cell.
+	 * @param func The function, taking the Entity index in the grid.
+	 */
+	template<typename Func>
+	void ForEachInCell(const Cell &cell, Func &&func) const;
+
+	Cell GetCell(const Vector &position) const noexcept;
+	CellRange GetCellRange(const Vector &min, const Vector &max) const noexcept;
+	std::size_t GetBucket(const Cell &cell) const noexcept;
+
+	float cellSize;
+	float inverseCellSize;
+
+	/// The Entities of the grid and their bounds, the index of these arrays is the Entity index in the grid.
+	std::vector<Entity::Id> ids;
+	std::vector<Sphere> bounds;
+	std::vector<Cell> cells;
+
+	/// Largest radius of the Entities stored in cells.
+	float margin = 0.0f;
+
+	/// Indices of the Entities kept out of the cells.
+	std::vector<std::uint32_t> oversized;
+
+	/// Start of each bucket in the entries array, followed by the end of the last one.
+	std::unique_ptr<std::atomic<std::uint32_t>[]> bucketStarts;
+	std::size_t bucketCount = 0;
+	std::size_t bucketCapacity = 0;
+
+	/// Entity indices sorted by the bucket of their cell, and the bucket of each Entity.
+	std::vector<std::uint32_t> entries;
+	std::vector<std::uint32_t> entryBuckets;
+};
+}
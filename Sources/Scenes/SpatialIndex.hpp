@@ -0,0 +1,141 @@
+#pragma once
+
+#include <algorithm>
+
+#include "Scene.hpp"
+#include "SpatialGrid.hpp"
+
+namespace acid {
+/**
+ * @brief A spatial grid of the Entities with a Component of a type, rebuilt when the Components were added, removed or changed.
+ * Additions and removals are followed through the Scene Component signals, changes through the Component change ticks,
+ * so Systems moving Entities must get their Components as changed. Disabled Entities are indexed too.
+ * @tparam T The Component type the bounds are read from.
+ */
+template<typename T>
+class SpatialIndex : public virtual Observer, public NonCopyable {
+public:
+	/// Function computing the bounding sphere of a Component.
+	using BoundsFunction = SpatialGrid::Sphere (*)(const T &);
+
+	/**
+	 * Creates a new index, it is built on the first update.
+	 * @param scene The Scene, it must outlive the index.
+	 * @param cellSize The size of the grid cells.
+	 * @param boundsFunction The function computing the bounds of the Components.
+	 */
+	SpatialIndex(Scene &scene, float cellSize, BoundsFunction boundsFunction) :
+		scene(scene),
+		grid(cellSize),
+		boundsFunction(boundsFunction) {
+		const auto markDirty = [this](const Entity::Id *, std::size_t) {
+			dirty = true;
+		};
+		scene.OnAdded<T>().Add(markDirty, this);
+		scene.OnRemoved<T>().Add(markDirty, this);
+	}
+
+	/**
+	 * Rebuilds the grid if Components were added, removed or changed since the last update, on the Scene thread pool if it has one.
+	 * A System calling it passes itself, so the Components it changes after the update are seen by the next one,
+	 * at the cost of one redundant rebuild when it changes the Components before.
+	 * @param system The System calling the update, or nullptr outside of System updates.
+	 * @return If the grid was rebuilt.
+	 */
+	bool Update(const System *system = nullptr) {
+		auto pool = scene.components.template GetPool<T>();
+		const auto size = pool ? pool->GetSize() : 0;
+
+		if (!dirty) {
+			const auto ticks = size != 0 ? pool->GetChangedTicks() : nullptr;
+
+			for (std::size_t i = 0; i < size && !dirty; ++i) {
+				dirty = ticks[i] > buildTick;
+			}
+		}
+
+		if (!dirty) {
+			return false;
+		}
+
+		// Changes stamped from now on are newer than the build, except those of the running System, which get its older run tick.
+		buildTick = scene.components.AdvanceChangeTick();
+
+		if (system && system->runTick != 0) {
+			buildTick = std::min(buildTick, system->runTick - 1);
+		}
+		dirty = false;
+
+		ids.resize(size);
+		bounds.resize(size);
+
+		if (size != 0) {
+			const auto entities = pool->GetEntities().data();
+			const auto data = pool->GetData();
+
+			for (std::size_t i = 0; i < size; ++i) {
+				ids[i] = entities[i];
+				bounds[i] = boundsFunction(data[i]);
+			}
+		}
+
+		grid.Build(ids.data(), bounds.data(), size, scene.GetThreadPool());
+		return true;
+	}
+
+	/**
+	 * Forces the grid to be rebuilt on the next update, when the bounds depend on more than the Component.
+	 */
+	void MarkDirty() noexcept { dirty = true; }
+
+	/**
+	 * Finds the Entities whose bounds intersect spheres.
+	 * @param queries The spheres.
+	 * @param count The number of spheres.
+	 * @param results The Entities found by each sphere, in no particular order.
+	 */
+	void Query(const SpatialGrid::Sphere *queries, std::size_t count, SpatialGrid::Results &results) const {
+		grid.Query(queries, count, results, scene.GetThreadPool());
+	}
+
+	/**
+	 * Finds the Entities whose bounds intersect boxes.
+	 * @param queries The boxes.
+	 * @param count The number of boxes.
+	 * @param results The Entities found by each box, in no particular order.
+	 */
+	void Query(const SpatialGrid::Box *queries, std::size_t count, SpatialGrid::Results &results) const {
+		grid.Query(queries, count, results, scene.GetThreadPool());
+	}
+
+	/**
+	 * Finds the Entities whose bounds are hit by rays.
+	 * @param queries The rays.
+	 * @param count The number of rays.
+	 * @param results The Entities hit by each ray, nearest first.
+	 */
+	void Query(const SpatialGrid::Ray *queries, std::size_t count, SpatialGrid::Results &results) const {
+		grid.Query(queries, count, results, scene.GetThreadPool());
+	}
+
+	/**
+	 * Gets the grid, as of the last update.
+	 * @return The grid.
+	 */
+	const SpatialGrid &GetGrid() const noexcept { return grid; }
+
+private:
+	Scene &scene;
+	SpatialGrid grid;
+	BoundsFunction boundsFunction;
+
+	/// If Components were added or removed since the last build.
+	bool dirty = true;
+	/// The change tick the grid was last built at.
+	ComponentPoolBase::Tick buildTick = 0;
+
+	/// Scratch Entity IDs and bounds the grid is built from.
+	std::vector<Entity::Id> ids;
+	std::vector<SpatialGrid::Sphere> bounds;
+};
+}
@@ -5,6 +5,9 @@
 
 namespace acid {
 void System::DetachAll() {
+	CountCallback(Profiler::Counter::Disables, enabledEntities.size());
+	CountCallback(Profiler::Counter::Detaches, enabledEntities.size() + disabledEntities.size());
+
 	// Enabled Entities.
 	for (auto &entity : enabledEntities) {
 		OnEntityDisable(entity);
@@ -19,16 +22,16 @@ void System::DetachAll() {
 	enabledEntities.clear();
 	disabledEntities.clear();
 
-	status.clear();
+	slots.Clear();
 }
 
 void System::AttachEntity(const Entity &entity) {
 	if (GetEntityStatus(entity) == EntityStatus::NotAttached) {
 		// Add Entity to the Disabled list. The Entity is not enabled by default.
-		disabledEntities.emplace_back(entity);
+		InsertEntity(entity, EntityStatus::Disabled);
 
+		CountCallback(Profiler::Counter::Attaches);
 		OnEntityAttach(entity);
-		SetEntityStatus(entity, EntityStatus::Disabled);
 	}
 }
 
@@ -36,43 +39,155 @@ void System::DetachEntity(const Entity &entity) {
 	const auto status = GetEntityStatus(entity);
 
 	if (status != EntityStatus::NotAttached) {
+		EraseEntity(entity);
+
 		if (status == EntityStatus::Enabled) {
-			// Remove Entity from Enabled list.
-			enabledEntities.erase(std::remove(enabledEntities.begin(), enabledEntities.end(), entity), enabledEntities.end());
+			CountCallback(Profiler::Counter::Disables);
 			OnEntityDisable(entity);
-		} else {
-			// Remove Entity from Disabled list.
-			disabledEntities.erase(std::remove(disabledEntities.begin(), disabledEntities.end(), entity), disabledEntities.end());
 		}
 
+		CountCallback(Profiler::Counter::Detaches);
 		OnEntityDetach(entity);
-		SetEntityStatus(entity, EntityStatus::NotAttached);
 	}
 }
 
 void System::EnableEntity(const Entity &entity) {
 	if (GetEntityStatus(entity) == EntityStatus::Disabled) {
-		// Remove Entity from Disabled list.
-		disabledEntities.erase(std::remove(disabledEntities.begin(), disabledEntities.end(), entity), disabledEntities.end());
-
-		// Then, add it to the Enabled list.
-		enabledEntities.emplace_back(entity);
+		// Move Entity from the Disabled list to the Enabled list.
+		EraseEntity(entity);
+		InsertEntity(entity, EntityStatus::Enabled);
 
+		CountCallback(Profiler::Counter::Enables);
 		OnEntityEnable(entity);
-		SetEntityStatus(entity, EntityStatus::Enabled);
 	}
 }
 
 void System::DisableEntity(const Entity &entity) {
 	if (GetEntityStatus(entity) == EntityStatus::Enabled) {
-		// Remove Entity from Enabled list.
-		enabledEntities.erase(std::remove(enabledEntities.begin(), enabledEntities.end(), entity), enabledEntities.end());
-
-		// Then, add it to the Disabled list.
-		disabledEntities.emplace_back(entity);
+		// Move Entity from the Enabled list to the Disabled list.
+		EraseEntity(entity);
+		InsertEntity(entity, EntityStatus::Disabled);
 
+		CountCallback(Profiler::Counter::Disables);
 		OnEntityDisable(entity);
-		SetEntityStatus(entity, EntityStatus::Disabled);
+	}
+}
+
+const ComponentHolder &System::GetComponentHolder() const {
+	return scene->components;
+}
+
+std::size_t System::GetGrainSize(std::size_t grainSize, bool deterministic) const {
+	// Number of Entities that fill a cache line.
+	constexpr std::size_t lineEntities = std::max<std::size_t>(64 / sizeof(Entity), 1);
+
+	if (grainSize == 0) {
+		if (deterministic) {
+			grainSize = 1024;
+		} else {
+			// About four chunks per thread, so threads that finish early can steal.
+			const auto threadCount = GetThreadPool() ? GetThreadPool()->GetThreadCount() : 1;
+			grainSize = std::max<std::size_t>(enabledEntities.size() / (threadCount * 4), 256);
+		}
+	}
+
+	return (grainSize + lineEntities - 1) / lineEntities * lineEntities;
+}
+
+const std::vector<std::uint32_t> *System::GatherPositions() {
+	if (filter.GetAdded().None() && filter.GetChanged().None()) {
+		return nullptr;
+	}
+
+	tickPositions.clear();
+
+	if (!GatherTickFilters()) {
+		return &tickPositions;
+	}
+
+	const auto &scanned = tickFilters.front();
+	const auto ids = scanned.pool->GetEntities().data();
+	const auto ticks = scanned.added ? scanned.pool->GetAddedTicks() : scanned.pool->GetChangedTicks();
+	const auto size = scanned.pool->GetSize();
+	const auto lastTick = lastRunTick;
+
+	for (std::size_t index = 0; index < size; ++index) {
+		if (ticks[index] <= lastTick) {
+			continue;
+		}
+
+		const auto id = ids[index];
+
+		if (!IsEnabled(id) || (tickFilters.size() > 1 && !CheckTicks(id))) {
+			continue;
+		}
+
+		tickPositions.emplace_back(slots.Get(Entity::GetIndex(id)).position);
+	}
+
+	// Keeps the order of unfiltered iteration, Entities attached in the order their Components were added are sorted already.
+	if (!std::is_sorted(tickPositions.begin(), tickPositions.end())) {
+		std::sort(tickPositions.begin(), tickPositions.end());
+	}
+	return &tickPositions;
+}
+
+bool System::GatherTickFilters() {
+	const auto &components = GetComponentHolder();
+	tickFilters.clear();
+
+	const auto addFilters = [&](const ComponentFilter::Mask &mask, bool added) {
+		mask.ForEach([&](std::size_t typeId) {
+			tickFilters.emplace_back(TickFilter{components.GetPool(static_cast<TypeId>(typeId)), added});
+		});
+	};
+
+	addFilters(filter.GetAdded(), true);
+	addFilters(filter.GetChanged(), false);
+
+	// Entities without a pool for a required Component are never attached.
+	for (const auto &tickFilter : tickFilters) {
+		if (!tickFilter.pool) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool System::CheckTicks(Entity::Id id) const {
+	for (const auto &tickFilter : tickFilters) {
+		const auto index = tickFilter.pool->GetIndex(id);
+
+		if (index == ComponentPoolBase::NullIndex) {
+			return false;
+		}
+
+		const auto tick = tickFilter.added ? tickFilter.pool->GetAddedTick(index) : tickFilter.pool->GetChangedTick(index);
+
+		if (tick <= lastRunTick) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+ComponentPoolBase::Tick System::GetRunTick() const {
+	return runTick != 0 ? runTick : GetComponentHolder().GetChangeTick();
+}
+
+CommandBuffer &System::GetCommands() {
+	return scene->GetCommands();
+}
+
+ThreadPool *System::GetThreadPool() const {
+	return scene->GetThreadPool();
+}
+
+void System::CountCallback(Profiler::Counter counter, std::size_t amount) {
+	if (scene) {
+		scene->profiler.Count(counter, amount);
 	}
 }
 
@@ -98,20 +213,37 @@ void System::Update(float delta) {
 }
 
 System::EntityStatus System::GetEntityStatus(Entity::Id id) const {
-	const auto it = status.find(id);
+	return slots.Get(Entity::GetIndex(id)).status;
+}
 
-	if (it != status.end()) {
-		return it->second;
-	}
+bool System::IsEnabled(Entity::Id id) const {
+	const auto &slot = slots.Get(Entity::GetIndex(id));
 
-	return EntityStatus::NotAttached;
+	// The slot may belong to an older Entity with the same index, attached Entities are checked by ID.
+	return slot.status == EntityStatus::Enabled && enabledEntities[slot.position].GetId() == id;
 }
 
-void System::SetEntityStatus(Entity::Id id, const EntityStatus &status) {
-	if (status == EntityStatus::NotAttached) {
-		this->status.erase(id);
-	} else {
-		this->status[id] = status;
+void System::InsertEntity(const Entity &entity, EntityStatus status) {
+	auto &entities = status == EntityStatus::Enabled ? enabledEntities : disabledEntities;
+	auto &slot = slots.Assure(entity.GetIndex());
+
+	slot.status = status;
+	slot.position = static_cast<std::uint32_t>(entities.size());
+	entities.emplace_back(entity);
+}
+
+void System::EraseEntity(const Entity &entity) {
+	auto &slot = slots.Assure(entity.GetIndex());
+	auto &entities = slot.status == EntityStatus::Enabled ? enabledEntities : disabledEntities;
+
+	// Swap with the last Entity so the removal does not shift the list.
+	if (slot.position + 1 != entities.size()) {
+		const auto &last = entities.back();
+		slots.Assure(last.GetIndex()).position = slot.position;
+		entities[slot.position] = last;
 	}
+
+	entities.pop_back();
+	slot = {};
 }
 }
@@ -1,27 +1,79 @@
 #pragma once
 
+#include <algorithm>
+#include <stdexcept>
+
+#include "Utils/ConstExpr.hpp"
 #include "Utils/NonCopyable.hpp"
+#include "Utils/Profiler.hpp"
+#include "Utils/ThreadPool.hpp"
 #include "Utils/TypeInfo.hpp"
 #include "Holders/ComponentFilter.hpp"
+#include "Holders/ComponentHolder.hpp"
+#include "Holders/SparseArray.hpp"
+#include "CommandBuffer.hpp"
 #include "Entity.hpp"
 
 namespace acid {
 class ACID_EXPORT System : public NonCopyable {
 	friend class Scene;
 	friend class SystemHolder;
+	template<typename> friend class SpatialIndex;
 public:
 	System() = default;
 
 	virtual ~System() = default;
 
 	/**
-	 * Iterates through all enabled Entities.
+	 * Iterates through all enabled Entities, skipping those without the Components the filter requires to be added or changed since the last run.
+	 * The function either takes the Entity alone, or the Entity followed by Component pointers, e.g. (Entity, Transform *, Rigidbody *).
+	 * Component pools are resolved once per call, a Component pointer is nullptr if the Entity does not have that Component.
+	 * Components taken through a non const pointer are marked as changed.
 	 * @tparam Func The function type.
 	 * @param func The function.
 	 */
 	template<typename Func>
 	void ForEach(Func &&func);
 
+	/**
+	 * Iterates through all enabled Entities in chunks run concurrently on the Scene thread pool, or sequentially if the Scene has none.
+	 * The function takes the same arguments as with ForEach, structural changes must be recorded with GetCommands.
+	 * @tparam Func The function type.
+	 * @param func The function.
+	 * @param grainSize The number of Entities per chunk, 0 picks one from the Entity and thread count.
+	 */
+	template<typename Func>
+	void ParallelForEach(Func &&func, std::size_t grainSize = 0);
+
+	/**
+	 * Reduces all enabled Entities in chunks run concurrently on the Scene thread pool. Each chunk accumulates into its own value,
+	 * chunk values are then combined in Entity order.
+	 * The function takes the accumulated value followed by the same arguments as with ForEach, e.g. (float &, Entity, const Transform *).
+	 * @tparam T The accumulated value type.
+	 * @tparam Func The function type.
+	 * @tparam Reduce The combine function type.
+	 * @param identity The initial value of every chunk.
+	 * @param func The function.
+	 * @param reduce The function combining two values.
+	 * @param grainSize The number of Entities per chunk, 0 picks one from the Entity and thread count.
+	 * @param deterministic If chunk boundaries must not depend on the thread count, so floating point results are reproducible across machines.
+	 * @return The combined value.
+	 */
+	template<typename T, typename Func, typename Reduce>
+	T ParallelReduce(T identity, Func &&func, Reduce &&reduce, std::size_t grainSize = 0, bool deterministic = false);
+
+	/**
+	 * Iterates through the Entities of the owning group of the function Components, walking the packed pools in parallel without lookups.
+	 * The function takes the Entity followed by Component pointers, e.g. (Entity, Transform *, Rigidbody *), all owned by the same group.
+	 * As with ForEach, only the enabled Entities attached to this System are visited, skipping those without the Components
+	 * the filter requires to be added or changed, but in the order of the group.
+	 * Components taken through a non const pointer are marked as changed. Throws if no group owns all the Components.
+	 * @tparam Func The function type.
+	 * @param func The function.
+	 */
+	template<typename Func>
+	void ForEachGroup(Func &&func);
+
 	/**
 	 * Detaches all entities.
 	 */
@@ -33,6 +85,18 @@ public:
 	 */
 	const std::vector<Entity> &GetEntities() const { return enabledEntities; }
 
+	/**
+	 * Gets the change tick of the last completed update of the System, Components changed after it are newer.
+	 * @return The change tick, 0 if the System has not been updated yet.
+	 */
+	ComponentPoolBase::Tick GetLastRunTick() const noexcept { return lastRunTick; }
+
+	/**
+	 * Gets the readable name of the System type, used by the Scene profiler and memory reports.
+	 * @return The System name, valid for the lifetime of the program.
+	 */
+	const char *GetName() const noexcept { return name; }
+
 	/**
 	 * Gets the Scene that the System belongs to.
 	 * @return The Scene.
@@ -41,11 +105,35 @@ public:
 
 protected:
 	/**
-	 * Gets the component filter.
+	 * Gets the component filter. It must be set up before the System is added to a Scene, the Scene caches matching results.
 	 * @return The component filter.
 	 */
 	ComponentFilter &GetFilter() { return filter; }
 
+	/**
+	 * Declares an owning group of Component types, created when the System is added to a Scene, for iteration with ForEachGroup.
+	 * A System owns one group at most, throws if it already declared one.
+	 * Throws when the System is added if a type is already owned by a different group.
+	 * @tparam Ts The Component types.
+	 */
+	template<typename... Ts>
+	void OwnGroup() {
+		if (groupFactory) {
+			throw std::runtime_error("System already owns a group");
+		}
+
+		groupFactory = [](ComponentHolder &components) {
+			components.AddGroup<Ts...>();
+		};
+	}
+
+	/**
+	 * Gets the Scene command buffer of the calling thread. Structural changes made from Update while Systems run in parallel,
+	 * or from ParallelForEach and ParallelReduce, must be recorded here, they are applied in a deterministic order when the Scene next updates its Entities.
+	 * @return The command buffer.
+	 */
+	CommandBuffer &GetCommands();
+
 	virtual void OnStart();
 	virtual void OnShutdown();
 	virtual void OnEntityAttach(Entity entity);
@@ -59,6 +147,120 @@ private:
 		NotAttached, Enabled, Disabled
 	};
 
+	/**
+	 * Gets the Component pointer types requested by a function after its Entity argument.
+	 * @tparam Func The function type.
+	 * @tparam Skip The number of arguments before the Entity argument.
+	 * @return A null pointer to a tuple of the Component pointer types.
+	 */
+	template<typename Func, std::size_t Skip = 0>
+	static constexpr auto GetComponentArgs();
+
+	/**
+	 * Iterates through a range of enabled Entities, passing in the requested Components.
+	 * @tparam Func The function type.
+	 * @tparam Args The Component pointer argument types.
+	 * @param begin The first position.
+	 * @param end The position after the last one.
+	 * @param positions The positions of the iterated Entities in the enabled Entities, or nullptr to iterate enabled Entities directly.
+	 * @param func The function.
+	 */
+	template<typename Func, typename... Args>
+	void ForEachRange(std::size_t begin, std::size_t end, const std::vector<std::uint32_t> *positions, Func &&func, std::tuple<Args...> *);
+
+	/**
+	 * Iterates through the Entities of the owning group of the Components, passing in the Components.
+	 * @tparam Func The function type.
+	 * @tparam Args The Component pointer argument types.
+	 * @param func The function.
+	 */
+	template<typename Func, typename... Args>
+	void ForEachGroupRange(Func &&func, std::tuple<Args...> *);
+
+	/**
+	 * Gets a Component argument for typed iteration, marking it as changed when taken through a non const pointer.
+	 * @tparam Arg The Component pointer type.
+	 * @tparam Pool The Component pool type.
+	 * @param pool The Component pool, or nullptr.
+	 * @param id The Entity ID.
+	 * @param tick The change tick.
+	 * @return The Component, or nullptr if the Entity does not have one.
+	 */
+	template<typename Arg, typename Pool>
+	static Arg GetComponentArg(Pool *pool, Entity::Id id, ComponentPoolBase::Tick tick);
+
+	/**
+	 * Marks a Component of a group pool as changed, when it is taken through a non const pointer.
+	 * @tparam Arg The Component pointer type.
+	 * @tparam Pool The Component pool type.
+	 * @param pool The Component pool.
+	 * @param index The dense index of the Component.
+	 * @param tick The change tick.
+	 */
+	template<typename Arg, typename Pool>
+	static void MarkGroupChanged(Pool *pool, std::size_t index, ComponentPoolBase::Tick tick);
+
+	class TickFilter {
+	public:
+		const ComponentPoolBase *pool;
+
+		/// If the Component must have been added since the last run, rather than changed.
+		bool added;
+	};
+
+	/**
+	 * Gathers the enabled Entities whose Components were added or changed since the last run, as the filter requires.
+	 * The pool of the first such Component is scanned in storage order, only the Entities it has changed are looked up.
+	 * @return The positions of the Entities in the enabled Entities in increasing order, or nullptr if the filter has no added or changed Components.
+	 */
+	const std::vector<std::uint32_t> *GatherPositions();
+
+	/**
+	 * Gathers the pools of the Components the filter requires to be added or changed into the tick filters.
+	 * @return If Entities can pass the tick filters, false if one of the pools does not exist.
+	 */
+	bool GatherTickFilters();
+
+	/**
+	 * Checks if the Components of an Entity have been added or changed since the last run.
+	 * @param id The Entity ID.
+	 * @return If the Entity passes every tick filter.
+	 */
+	bool CheckTicks(Entity::Id id) const;
+
+	/**
+	 * Gets the change tick stamped on Components changed by typed iteration.
+	 * @return The tick of the current update, or the current change tick outside of updates.
+	 */
+	ComponentPoolBase::Tick GetRunTick() const;
+
+	/**
+	 * Gets the number of Entities per chunk for parallel iteration, rounded to whole cache lines of Entities.
+	 * @param grainSize The requested grain size, 0 picks one.
+	 * @param deterministic If the grain size must not depend on the thread count.
+	 * @return The grain size.
+	 */
+	std::size_t GetGrainSize(std::size_t grainSize, bool deterministic) const;
+
+	/**
+	 * Gets the thread pool of the Scene.
+	 * @return The thread pool, or nullptr if the Scene has none.
+	 */
+	ThreadPool *GetThreadPool() const;
+
+	/**
+	 * Adds to a callback counter of the Scene profiler.
+	 * @param counter The counter.
+	 * @param amount The number of callbacks.
+	 */
+	void CountCallback(Profiler::Counter counter, std::size_t amount = 1);
+
+	/**
+	 * Gets the Component holder of the Scene.
+	 * @return The Component holder.
+	 */
+	const ComponentHolder &GetComponentHolder() const;
+
 	/**
 	 * Attach an Entity to the System.
 	 * @param entity
@@ -91,11 +293,33 @@ private:
 	EntityStatus GetEntityStatus(Entity::Id id) const;
 
 	/**
-	 * Set Entity status.
+	 * Gets if an Entity is attached to this System and enabled.
 	 * @param id The Entity ID.
-	 * @param status The status.
+	 * @return If the Entity is enabled.
+	 */
+	bool IsEnabled(Entity::Id id) const;
+
+	/**
+	 * Appends an Entity to the list matching the status.
+	 * @param entity The Entity.
+	 * @param status The status, Enabled or Disabled.
+	 */
+	void InsertEntity(const Entity &entity, EntityStatus status);
+
+	/**
+	 * Removes an Entity from the list matching its current status, by moving the last Entity of that list into its position.
+	 * @param entity The Entity.
 	 */
-	void SetEntityStatus(Entity::Id id, const EntityStatus &status);
+	void EraseEntity(const Entity &entity);
+
+	class EntitySlot {
+	public:
+		/// Attach and enable status.
+		EntityStatus status = EntityStatus::NotAttached;
+
+		/// Position of the Entity in the enabled or disabled list.
+		std::uint32_t position = 0;
+	};
 
 	/// Enabled Entities attached to this System.
 	std::vector<Entity> enabledEntities;
@@ -103,14 +327,33 @@ private:
 	/// Disabled Entities attached to this System.
 	std::vector<Entity> disabledEntities;
 
-	/// Entities attach and enable status.
-	std::unordered_map<Entity::Id, EntityStatus> status;
+	/// Entities attach and enable status, and their position in the Entity lists.
+	/// The index of this array matches the Entity index.
+	SparseArray<EntitySlot> slots;
 
 	/// The Scene that this System belongs to.
 	Scene *scene = nullptr;
 
+	/// The readable name of the System type, set when the System is added to a Scene.
+	const char *name = "System";
+
+	/// Change tick of the current update, 0 outside of Update.
+	ComponentPoolBase::Tick runTick = 0;
+
+	/// Change tick of the last completed update.
+	ComponentPoolBase::Tick lastRunTick = 0;
+
+	/// Scratch pools of the Components that must have been added or changed.
+	std::vector<TickFilter> tickFilters;
+
+	/// Scratch positions of the Entities gathered by their Component ticks.
+	std::vector<std::uint32_t> tickPositions;
+
 	/// The mask that the Entities must matched to be attached to this System.
 	ComponentFilter filter;
+
+	/// Creates the owning group declared by the System, or nullptr.
+	void (*groupFactory)(ComponentHolder &) = nullptr;
 };
 
 // Get the Type ID for the System T
@@ -5,11 +5,192 @@
 namespace acid {
 template<typename Func>
 void System::ForEach(Func &&func) {
-	for (const auto &entity : enabledEntities) {
-		if (entity.IsValid()) {
-			func(entity);
+	const auto positions = GatherPositions();
+	const auto count = positions ? positions->size() : enabledEntities.size();
+	ForEachRange(0, count, positions, std::forward<Func>(func), GetComponentArgs<Func>());
+}
+
+template<typename Func>
+void System::ParallelForEach(Func &&func, std::size_t grainSize) {
+	auto pool = GetThreadPool();
+	const auto positions = GatherPositions();
+	const auto count = positions ? positions->size() : enabledEntities.size();
+	grainSize = GetGrainSize(grainSize, false);
+
+	if (!pool || count <= grainSize) {
+		ForEachRange(0, count, positions, std::forward<Func>(func), GetComponentArgs<Func>());
+		return;
+	}
+
+	ThreadPool::TaskGroup group;
+
+	// Each chunk records commands under the next key, so they apply in Entity order whichever thread ran the chunk.
+	const auto key = CommandBuffer::GetKey();
+	std::uint64_t chunk = 0;
+
+	for (std::size_t begin = 0; begin < count; begin += grainSize) {
+		const auto end = std::min(begin + grainSize, count);
+
+		pool->Run(group, [this, &func, positions, begin, end, chunkKey = key + ++chunk] {
+			CommandBuffer::Scope scope(chunkKey);
+			ForEachRange(begin, end, positions, func, GetComponentArgs<Func>());
+		});
+	}
+
+	pool->Wait(group);
+	CommandBuffer::SetKey(key + chunk + 1);
+}
+
+template<typename T, typename Func, typename Reduce>
+T System::ParallelReduce(T identity, Func &&func, Reduce &&reduce, std::size_t grainSize, bool deterministic) {
+	auto pool = GetThreadPool();
+	const auto positions = GatherPositions();
+	const auto count = positions ? positions->size() : enabledEntities.size();
+	grainSize = GetGrainSize(grainSize, deterministic);
+
+	const auto chunkCount = (count + grainSize - 1) / grainSize;
+	std::vector<T> values(chunkCount, identity);
+	ThreadPool::TaskGroup group;
+	const auto key = CommandBuffer::GetKey();
+
+	for (std::size_t chunk = 0; chunk < chunkCount; ++chunk) {
+		auto task = [this, &func, &values, positions, count, chunk, grainSize, chunkKey = key + chunk + 1] {
+			CommandBuffer::Scope scope(chunkKey);
+			const auto begin = chunk * grainSize;
+			const auto end = std::min(begin + grainSize, count);
+			auto &value = values[chunk];
+
+			ForEachRange(begin, end, positions, [&func, &value](const Entity &entity, auto *...components) {
+				func(value, entity, components...);
+			}, GetComponentArgs<Func, 1>());
+		};
+
+		// Chunks are still made without a pool, so deterministic results do not depend on it.
+		if (pool) {
+			pool->Run(group, std::move(task));
+		} else {
+			task();
 		}
 	}
+
+	if (pool) {
+		pool->Wait(group);
+	}
+
+	CommandBuffer::SetKey(key + chunkCount + 1);
+
+	auto result = std::move(identity);
+
+	for (auto &value : values) {
+		result = reduce(std::move(result), std::move(value));
+	}
+
+	return result;
+}
+
+template<typename Func, std::size_t Skip>
+constexpr auto System::GetComponentArgs() {
+	if constexpr (Skip == 0 && std::is_invocable_v<Func, Entity>) {
+		// Also covers generic functions, that only get the Entity.
+		return static_cast<std::tuple<> *>(nullptr);
+	} else {
+		using Args = function_args_t<Func>;
+		static_assert(std::is_convertible_v<Entity, std::tuple_element_t<Skip, Args>>, "The Entity must be the argument before the Components.");
+
+		return static_cast<tuple_drop_t<Skip + 1, Args> *>(nullptr);
+	}
+}
+
+template<typename Func, typename... Args>
+void System::ForEachRange(std::size_t begin, std::size_t end, const std::vector<std::uint32_t> *positions, Func &&func, std::tuple<Args...> *) {
+	static_assert((std::is_pointer_v<Args> && ...), "Components must be taken by pointer.");
+
+	const auto &components = GetComponentHolder();
+	const auto tick = GetRunTick();
+
+	// Attached Entities are always valid, removed Entities are detached before their ID is recycled.
+	std::apply([&](auto *...pools) {
+		for (auto i = begin; i < end; ++i) {
+			const auto &entity = enabledEntities[positions ? (*positions)[i] : i];
+			func(entity, GetComponentArg<Args>(pools, entity.GetId(), tick)...);
+		}
+	}, std::make_tuple(components.GetPool<std::remove_const_t<std::remove_pointer_t<Args>>>()...));
+}
+
+template<typename Func>
+void System::ForEachGroup(Func &&func) {
+	ForEachGroupRange(std::forward<Func>(func), GetComponentArgs<Func>());
+}
+
+template<typename Func, typename... Args>
+void System::ForEachGroupRange(Func &&func, std::tuple<Args...> *) {
+	static_assert(sizeof...(Args) != 0, "Group iteration takes the Components of the group.");
+	static_assert((std::is_pointer_v<Args> && ...), "Components must be taken by pointer.");
+
+	const auto &components = GetComponentHolder();
+	const auto group = components.GetGroup<std::remove_const_t<std::remove_pointer_t<Args>>...>();
+
+	if (!group) {
+		throw std::runtime_error("Components are not owned by one group");
+	}
+
+	const auto size = group->GetSize();
+
+	if (size == 0) {
+		return;
+	}
+
+	// Entities must pass the change filters as with ForEach, the pools they are checked against are gathered once.
+	const auto ticked = filter.GetAdded().Any() || filter.GetChanged().Any();
+
+	if (ticked && !GatherTickFilters()) {
+		return;
+	}
+
+	const auto tick = GetRunTick();
+	const auto ids = components.GetPool(group->GetTypes().front())->GetEntities().data();
+
+	// The first Components of each owned pool belong to the same Entities, in the same order.
+	std::apply([&](auto *...pools) {
+		std::apply([&](auto *...data) {
+			for (std::size_t i = 0; i < size; ++i) {
+				const auto id = ids[i];
+
+				if (!IsEnabled(id) || (ticked && !CheckTicks(id))) {
+					continue;
+				}
+
+				(MarkGroupChanged<Args>(pools, i, tick), ...);
+				func(Entity(id, scene), data + i...);
+			}
+		}, std::make_tuple(pools->GetData()...));
+	}, std::make_tuple(components.GetPool<std::remove_const_t<std::remove_pointer_t<Args>>>()...));
+}
+
+template<typename Arg, typename Pool>
+void System::MarkGroupChanged(Pool *pool, std::size_t index, ComponentPoolBase::Tick tick) {
+	if constexpr (!std::is_const_v<std::remove_pointer_t<Arg>>) {
+		pool->SetChangedTick(static_cast<ComponentPoolBase::Index>(index), tick);
+	}
+}
+
+template<typename Arg, typename Pool>
+Arg System::GetComponentArg(Pool *pool, Entity::Id id, ComponentPoolBase::Tick tick) {
+	if (!pool) {
+		return nullptr;
+	}
+
+	const auto index = pool->GetIndex(id);
+
+	if (index == ComponentPoolBase::NullIndex) {
+		return nullptr;
+	}
+
+	if constexpr (!std::is_const_v<std::remove_pointer_t<Arg>>) {
+		pool->SetChangedTick(index, tick);
+	}
+
+	return pool->GetData() + index;
 }
 
 template<typename T>
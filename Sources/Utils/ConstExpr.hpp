@@ -5,6 +5,7 @@
 #include <vector>
 #include <map>
 #include <memory>
+#include <tuple>
 
 namespace acid {
 template<typename T>
@@ -87,6 +88,47 @@ inline constexpr bool is_weak_ptr_v = is_weak_ptr<T>::value;
 template<typename T>
 inline constexpr bool is_ptr_access_v = std::is_pointer_v<T> || is_unique_ptr_v<T> || is_shared_ptr_v<T> || is_weak_ptr_v<T>;
 
+template<typename T>
+struct function_traits : function_traits<decltype(&T::operator())> {
+};
+
+template<typename R, typename... Args>
+struct function_traits<R(*)(Args...)> {
+	using return_type = R;
+	using args_type = std::tuple<Args...>;
+};
+
+template<typename C, typename R, typename... Args>
+struct function_traits<R(C::*)(Args...)> : function_traits<R(*)(Args...)> {
+};
+
+template<typename C, typename R, typename... Args>
+struct function_traits<R(C::*)(Args...) const> : function_traits<R(*)(Args...)> {
+};
+
+template<typename T>
+using function_args_t = typename function_traits<std::decay_t<T>>::args_type;
+
+template<typename T>
+struct tuple_tail;
+
+template<typename T, typename... Ts>
+struct tuple_tail<std::tuple<T, Ts...>> {
+	using type = std::tuple<Ts...>;
+};
+
+template<std::size_t N, typename T>
+struct tuple_drop : tuple_drop<N - 1, typename tuple_tail<T>::type> {
+};
+
+template<typename T>
+struct tuple_drop<0, T> {
+	using type = T;
+};
+
+template<std::size_t N, typename T>
+using tuple_drop_t = typename tuple_drop<N, T>::type;
+
 // TODO C++20: std::to_address
 template<typename T>
 static T *to_address(T *obj) noexcept { return obj; }
@@ -1,15 +1,28 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <mutex>
 
 #include "ConstExpr.hpp"
 #include "NonCopyable.hpp"
+#include "SmallFunction.hpp"
 
 namespace acid {
-template<typename>
+/**
+ * How a Delegate stores and invokes its functions.
+ */
+enum class DelegateMode {
+	/// Functions are invoked under a lock, and their observers checked on every invoke.
+	Locked,
+	/// Functions are invoked without locking or allocating, from an immutable list that changes are copied into.
+	CopyOnWrite
+};
+
+template<typename, DelegateMode = DelegateMode::Locked>
 class Delegate;
 
 class ACID_EXPORT Observer {
@@ -18,9 +31,22 @@ public:
 		valid(std::make_shared<bool>(true)) {
 	}
 
-	virtual ~Observer() = default;
+	virtual ~Observer() {
+		// Expires the observer before it is counted, so a sweep that sees the count also sees it expired.
+		valid.reset();
+		destroyedCount.fetch_add(1, std::memory_order_acq_rel);
+	}
+
+	/**
+	 * Gets the number of observers destroyed so far, Delegates only look for expired functions when it changes.
+	 * @return The number of destroyed observers.
+	 */
+	static std::uint64_t GetDestroyedCount() noexcept { return destroyedCount.load(std::memory_order_acquire); }
 
 	std::shared_ptr<bool> valid;
+
+private:
+	static inline std::atomic<std::uint64_t> destroyedCount = 0;
 };
 
 template<typename TReturnType, typename ...TArgs>
@@ -38,7 +64,7 @@ public:
 				continue;
 			}
 
-			returnValues.emplace_back((*it->function)(params...));
+			returnValues.emplace_back(it->function(params...));
 			++it;
 		}
 
@@ -71,7 +97,7 @@ public:
 };
 
 template<typename TReturnType, typename ...TArgs>
-class Delegate<TReturnType(TArgs ...)> {
+class Delegate<TReturnType(TArgs ...), DelegateMode::Locked> {
 public:
 	using Invoker = acid::Invoker<TReturnType, TArgs...>;
 	using FunctionType = std::function<TReturnType(TArgs ...)>;
@@ -202,6 +228,375 @@ private:
 	std::vector<FunctionPair> functions;
 };
 
+/**
+ * @brief A Delegate for functions invoked often, such as per Entity events. Invoking takes no lock and allocates nothing:
+ * it reads an immutable list of functions, and adding or removing functions publishes a modified copy of the list.
+ * Replaced lists are freed once no invoke is reading them. Functions are stored in a SmallFunction, lambdas capturing a few pointers are not allocated.
+ * Functions whose observers expired are swept out of the list in a batch, the first time the Delegate is invoked after any Observer was destroyed.
+ * Functions may be added and removed from within a function, the change applies from the next invoke.
+ * @tparam TReturnType The return type.
+ * @tparam TArgs The argument types.
+ */
+template<typename TReturnType, typename ...TArgs>
+class Delegate<TReturnType(TArgs ...), DelegateMode::CopyOnWrite> : public NonCopyable {
+public:
+	using FunctionType = SmallFunction<TReturnType(TArgs ...)>;
+	using ObserversType = std::vector<std::weak_ptr<bool>>;
+	using FunctionId = std::uint64_t;
+
+	Delegate() = default;
+
+	~Delegate() {
+		delete current.load(std::memory_order_acquire);
+
+		for (const auto &retiredList : retired) {
+			delete retiredList.list;
+		}
+	}
+
+	/**
+	 * Adds a function.
+	 * @tparam KArgs The observer types.
+	 * @param function The function.
+	 * @param args The observers, the function is removed once any of them is destroyed.
+	 * @return The function ID, to remove it with.
+	 */
+	template<typename ...KArgs>
+	FunctionId Add(FunctionType &&function, KArgs ...args) {
+		FunctionPair pair{0, std::move(function), {}};
+
+		if constexpr (sizeof...(args) != 0) {
+			for (const auto &arg : {args...}) {
+				pair.observers.emplace_back(to_address(arg)->valid);
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		pair.id = ++lastId;
+
+		auto list = Copy([](const FunctionPair &) {
+			return true;
+		});
+		list->observed |= !pair.observers.empty();
+		list->functions.emplace_back(std::move(pair));
+		Publish(list);
+		return lastId;
+	}
+
+	/**
+	 * Removes a function.
+	 * @param id The function ID, returned by Add.
+	 */
+	void Remove(FunctionId id) {
+		std::lock_guard<std::mutex> lock(mutex);
+		Publish(Copy([id](const FunctionPair &f) {
+			return f.id != id;
+		}));
+	}
+
+	/**
+	 * Removes all functions added with any of the observers.
+	 * @tparam KArgs The observer types.
+	 * @param args The observers.
+	 */
+	template<typename ...KArgs>
+	void RemoveObservers(KArgs ...args) {
+		std::vector<const bool *> removes;
+
+		if constexpr (sizeof...(args) != 0) {
+			for (const auto &arg : {args...}) {
+				removes.emplace_back(to_address(arg)->valid.get());
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		Publish(Copy([&removes](const FunctionPair &f) {
+			for (const auto &observer : f.observers) {
+				auto opt = observer.lock();
+
+				if (std::find(removes.begin(), removes.end(), opt.get()) != removes.end()) {
+					return false;
+				}
+			}
+
+			return true;
+		}));
+	}
+
+	/**
+	 * Removes all functions.
+	 */
+	void Clear() {
+		std::lock_guard<std::mutex> lock(mutex);
+		Publish(nullptr);
+	}
+
+	/**
+	 * Removes the functions whose observers expired, invoking does so when needed.
+	 */
+	void Sweep() {
+		std::lock_guard<std::mutex> lock(mutex);
+		SweepLocked();
+	}
+
+	/**
+	 * Gets the number of functions, including those whose observers expired since the last sweep.
+	 * @return The number of functions.
+	 */
+	std::size_t GetSize() const {
+		Reader reader(*this);
+		return reader.list ? reader.list->functions.size() : 0;
+	}
+
+	/**
+	 * Invokes all functions, in the order they were added, discarding their return values.
+	 * @param args The arguments.
+	 */
+	void Invoke(TArgs ...args) {
+		ForEach([&](const FunctionType &function) {
+			function(args...);
+		});
+	}
+
+	/**
+	 * Invokes all functions, in the order they were added, passing each return value to a function.
+	 * @tparam Func The function type.
+	 * @param func The function taking each return value.
+	 * @param args The arguments.
+	 */
+	template<typename Func>
+	void Collect(Func &&func, TArgs ...args) {
+		static_assert(!std::is_void_v<TReturnType>, "Functions return no value.");
+
+		ForEach([&](const FunctionType &function) {
+			func(function(args...));
+		});
+	}
+
+	void operator()(TArgs ...args) {
+		Invoke(args...);
+	}
+
+private:
+	class FunctionPair {
+	public:
+		bool IsExpired() const {
+			for (const auto &observer : observers) {
+				if (observer.expired()) {
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		FunctionId id;
+		FunctionType function;
+		ObserversType observers;
+	};
+
+	class FunctionList {
+	public:
+		std::vector<FunctionPair> functions;
+
+		/// If any function has observers.
+		bool observed = false;
+
+		/// The destroyed observer count when the list was last swept, functions may have expired if it has changed since.
+		std::atomic<std::uint64_t> sweptCount = 0;
+	};
+
+	/**
+	 * @brief Counts an invoke as reading the current list, so it is not freed while being read.
+	 * Readers are counted in the epoch that is still current once counted, a list is only read by readers of the epochs it was current in.
+	 */
+	class Reader {
+	public:
+		explicit Reader(const Delegate &delegate) :
+			delegate(delegate) {
+			while (true) {
+				epoch = delegate.epoch.load(std::memory_order_seq_cst);
+				delegate.readers[epoch & 1].fetch_add(1, std::memory_order_seq_cst);
+
+				if (delegate.epoch.load(std::memory_order_seq_cst) == epoch) {
+					break;
+				}
+
+				delegate.readers[epoch & 1].fetch_sub(1, std::memory_order_seq_cst);
+			}
+
+			list = delegate.current.load(std::memory_order_seq_cst);
+		}
+
+		~Reader() {
+			delegate.readers[epoch & 1].fetch_sub(1, std::memory_order_seq_cst);
+
+			if (delegate.hasRetired.load(std::memory_order_relaxed)) {
+				// Replaced lists are freed by readers as their epoch drains, unless a change is being made which will.
+				std::unique_lock<std::mutex> lock(delegate.mutex, std::try_to_lock);
+
+				if (lock.owns_lock()) {
+					delegate.Reclaim();
+				}
+			}
+		}
+
+		const Delegate &delegate;
+		std::uint64_t epoch;
+		const FunctionList *list;
+	};
+
+	class RetiredList {
+	public:
+		FunctionList *list;
+
+		/// The epoch the list was replaced in.
+		std::uint64_t epoch;
+	};
+
+	template<typename Func>
+	void ForEach(Func &&func) {
+		Reader reader(*this);
+
+		if (reader.list && IsStale(*reader.list)) {
+			std::unique_lock<std::mutex> lock(mutex, std::try_to_lock);
+
+			if (lock.owns_lock()) {
+				SweepLocked();
+				// A list published since the reader was counted is replaced in its epoch or a later one, so it is safe to read too.
+				reader.list = current.load(std::memory_order_seq_cst);
+			}
+		}
+
+		if (!reader.list) {
+			return;
+		}
+
+		// If the sweep was skipped because a change is being made, expired functions are skipped one by one.
+		const auto check = IsStale(*reader.list);
+
+		for (const auto &pair : reader.list->functions) {
+			if (check && pair.IsExpired()) {
+				continue;
+			}
+
+			func(pair.function);
+		}
+	}
+
+	static bool IsStale(const FunctionList &list) noexcept {
+		return list.observed && list.sweptCount.load(std::memory_order_relaxed) != Observer::GetDestroyedCount();
+	}
+
+	/**
+	 * Copies the current list, must be called with the mutex locked.
+	 * @tparam Func The filter type.
+	 * @param keep The filter, returning if a function is copied.
+	 * @return The new list.
+	 */
+	template<typename Func>
+	FunctionList *Copy(Func &&keep) const {
+		auto list = new FunctionList();
+		auto old = current.load(std::memory_order_relaxed);
+
+		if (old) {
+			list->functions.reserve(old->functions.size() + 1);
+			list->sweptCount.store(old->sweptCount.load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+			for (const auto &pair : old->functions) {
+				if (keep(pair)) {
+					list->observed |= !pair.observers.empty();
+					list->functions.emplace_back(pair);
+				}
+			}
+		}
+
+		return list;
+	}
+
+	void SweepLocked() {
+		auto list = current.load(std::memory_order_relaxed);
+
+		if (!list || !IsStale(*list)) {
+			return;
+		}
+
+		// Read first, observers destroyed during the sweep are swept by the next one.
+		const auto destroyedCount = Observer::GetDestroyedCount();
+		const auto expired = std::any_of(list->functions.begin(), list->functions.end(), [](const FunctionPair &f) {
+			return f.IsExpired();
+		});
+
+		if (!expired) {
+			list->sweptCount.store(destroyedCount, std::memory_order_relaxed);
+			return;
+		}
+
+		auto swept = Copy([](const FunctionPair &f) {
+			return !f.IsExpired();
+		});
+		swept->sweptCount.store(destroyedCount, std::memory_order_relaxed);
+		Publish(swept);
+	}
+
+	/**
+	 * Replaces the current list, must be called with the mutex locked.
+	 * @param list The new list.
+	 */
+	void Publish(FunctionList *list) {
+		if (auto old = current.exchange(list, std::memory_order_seq_cst)) {
+			retired.emplace_back(RetiredList{old, epoch.load(std::memory_order_relaxed)});
+			hasRetired.store(true, std::memory_order_relaxed);
+		}
+
+		Reclaim();
+	}
+
+	/**
+	 * Frees the replaced lists no invoke can be reading, must be called with the mutex locked.
+	 * A list replaced in an epoch may be read by readers of that epoch and earlier ones. Once the readers of the previous epoch are done,
+	 * the lists replaced before the current epoch are freed, and the epoch advances so the readers of lists replaced since drain without new ones joining.
+	 */
+	void Reclaim() const {
+		while (!retired.empty()) {
+			// The epoch only changes with the mutex locked, and the epoch before last has drained before the current one started.
+			const auto now = epoch.load(std::memory_order_relaxed);
+
+			if (readers[(now + 1) & 1].load(std::memory_order_seq_cst) != 0) {
+				break;
+			}
+
+			retired.erase(std::remove_if(retired.begin(), retired.end(), [now](const RetiredList &retiredList) {
+				if (retiredList.epoch >= now) {
+					return false;
+				}
+
+				delete retiredList.list;
+				return true;
+			}), retired.end());
+
+			if (!retired.empty()) {
+				epoch.store(now + 1, std::memory_order_seq_cst);
+			}
+		}
+
+		hasRetired.store(!retired.empty(), std::memory_order_relaxed);
+	}
+
+	/// Locked while changing the list, never while invoking.
+	mutable std::mutex mutex;
+	std::atomic<FunctionList *> current = nullptr;
+
+	/// Readers counted by the parity of the epoch they started in.
+	mutable std::atomic<std::uint64_t> epoch = 0;
+	mutable std::atomic<std::size_t> readers[2] = {};
+
+	/// Replaced lists, freed once no invoke can be reading them.
+	mutable std::vector<RetiredList> retired;
+	mutable std::atomic<bool> hasRetired = false;
+	FunctionId lastId = 0;
+};
+
 template<typename T>
 class DelegateValue : public Delegate<void(T)>, NonCopyable {
 public:
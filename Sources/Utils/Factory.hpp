@@ -4,6 +4,7 @@
 #include <iomanip>
 #include <unordered_map>
 #include <iostream>
+#include <memory>
 
 //#include "Engine/Log.hpp"
 
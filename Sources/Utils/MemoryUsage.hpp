@@ -0,0 +1,61 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+
+#include "Export.hpp"
+
+namespace acid {
+/**
+ * @brief The bytes a structure uses for its elements, and the bytes it has allocated including spare capacity.
+ */
+class ACID_EXPORT MemoryUsage {
+public:
+	/// Bytes holding live elements.
+	std::size_t used = 0;
+
+	/// Bytes allocated, used or not.
+	std::size_t reserved = 0;
+
+	MemoryUsage &operator+=(const MemoryUsage &other) noexcept {
+		used += other.used;
+		reserved += other.reserved;
+		return *this;
+	}
+
+	/**
+	 * Raises this usage to another one, for high-water marks.
+	 * @param other The other usage.
+	 */
+	void Max(const MemoryUsage &other) noexcept {
+		used = std::max(used, other.used);
+		reserved = std::max(reserved, other.reserved);
+	}
+
+	/**
+	 * Gets the memory usage of a vector, not counting the memory its elements own.
+	 * @tparam Vector The vector type.
+	 * @param vector The vector.
+	 * @return The memory usage.
+	 */
+	template<typename Vector>
+	static MemoryUsage Of(const Vector &vector) noexcept {
+		using Value = typename Vector::value_type;
+		return {vector.size() * sizeof(Value), vector.capacity() * sizeof(Value)};
+	}
+
+	/**
+	 * Gets the memory a string allocated, 0 while its characters fit inside the string object.
+	 * @param string The string.
+	 * @return The memory usage.
+	 */
+	static MemoryUsage Of(const std::string &string) noexcept {
+		if (string.capacity() <= std::string().capacity()) {
+			return {};
+		}
+
+		return {string.size() + 1, string.capacity() + 1};
+	}
+};
+}
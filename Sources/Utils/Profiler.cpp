@@ -0,0 +1,167 @@
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <iomanip>
+
+namespace acid {
+Profiler::Profiler(std::size_t frameCapacity) :
+	epoch(Clock::now()),
+	frames(std::max<std::size_t>(frameCapacity, 1)) {
+}
+
+void Profiler::SetEnabled(bool enabled) {
+	std::lock_guard<std::mutex> lock(mutex);
+	this->enabled.store(enabled, std::memory_order_relaxed);
+	recording = false;
+}
+
+void Profiler::BeginFrame() {
+	if (!IsEnabled()) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	current.index = frameIndex++;
+	current.start = GetTime(Clock::now());
+	current.events.clear();
+
+	for (auto &counter : counters) {
+		counter.store(0, std::memory_order_relaxed);
+	}
+
+	recording = true;
+}
+
+void Profiler::EndFrame() {
+	if (!IsEnabled()) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (!recording) {
+		return;
+	}
+
+	current.duration = GetTime(Clock::now()) - current.start;
+
+	for (std::size_t i = 0; i < counters.size(); ++i) {
+		current.counters[i] = counters[i].load(std::memory_order_relaxed);
+	}
+
+	// Swapping keeps the event storage of the replaced frame for the next one.
+	std::swap(frames[next], current);
+	next = (next + 1) % frames.size();
+	count = std::min(count + 1, frames.size());
+	recording = false;
+}
+
+void Profiler::AddEvent(const char *name, Clock::time_point start, Clock::time_point end) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (!recording) {
+		return;
+	}
+
+	const auto begin = GetTime(start);
+	current.events.emplace_back(Event{name, begin, GetTime(end) - begin, GetThreadIndex()});
+}
+
+std::vector<Profiler::Frame> Profiler::GetFrames() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	std::vector<Frame> result;
+	result.reserve(count);
+
+	for (std::size_t i = 0; i < count; ++i) {
+		result.emplace_back(frames[(next + frames.size() - count + i) % frames.size()]);
+	}
+
+	return result;
+}
+
+void Profiler::ClearFrames() {
+	std::lock_guard<std::mutex> lock(mutex);
+	next = 0;
+	count = 0;
+}
+
+void Profiler::WriteChromeTrace(std::ostream &stream) const {
+	// Timestamps of trace events are in microseconds.
+	const auto micros = [](std::int64_t nanos) {
+		return static_cast<double>(nanos) / 1000.0;
+	};
+	const auto writeName = [&stream](const char *name) {
+		stream << '"';
+
+		for (; *name != '\0'; ++name) {
+			if (*name == '"' || *name == '\\') {
+				stream << '\\';
+			}
+
+			stream << *name;
+		}
+
+		stream << '"';
+	};
+
+	bool first = true;
+	const auto separate = [&stream, &first] {
+		stream << (first ? "\n" : ",\n");
+		first = false;
+	};
+
+	const auto flags = stream.flags();
+	const auto precision = stream.precision();
+	stream << std::fixed << std::setprecision(3) << "{\"traceEvents\": [";
+
+	for (const auto &frame : GetFrames()) {
+		separate();
+		stream << "{\"name\": \"Frame " << frame.index << "\", \"cat\": \"frame\", \"ph\": \"X\", \"pid\": 0, \"tid\": 0, \"ts\": "
+			<< micros(frame.start) << ", \"dur\": " << micros(frame.duration) << '}';
+
+		for (const auto &event : frame.events) {
+			separate();
+			stream << "{\"name\": ";
+			writeName(event.name);
+			stream << ", \"cat\": \"scene\", \"ph\": \"X\", \"pid\": 0, \"tid\": " << event.thread << ", \"ts\": " << micros(event.start)
+				<< ", \"dur\": " << micros(event.duration) << '}';
+		}
+
+		for (std::size_t i = 0; i < frame.counters.size(); ++i) {
+			separate();
+			stream << "{\"name\": \"" << GetCounterName(static_cast<Counter>(i)) << "\", \"ph\": \"C\", \"pid\": 0, \"ts\": "
+				<< micros(frame.start) << ", \"args\": {\"value\": " << frame.counters[i] << "}}";
+		}
+	}
+
+	stream << "\n], \"displayTimeUnit\": \"ns\"}\n";
+	stream.flags(flags);
+	stream.precision(precision);
+}
+
+const char *Profiler::GetCounterName(Counter counter) noexcept {
+	switch (counter) {
+	case Counter::Actions:
+		return "Actions";
+	case Counter::Attaches:
+		return "Attaches";
+	case Counter::Detaches:
+		return "Detaches";
+	case Counter::Enables:
+		return "Enables";
+	case Counter::Disables:
+		return "Disables";
+	default:
+		return "Unknown";
+	}
+}
+
+std::int64_t Profiler::GetTime(Clock::time_point time) const noexcept {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(time - epoch).count();
+}
+
+std::uint32_t Profiler::GetThreadIndex() {
+	const auto it = threads.emplace(std::this_thread::get_id(), static_cast<std::uint32_t>(threads.size())).first;
+	return it->second;
+}
+}
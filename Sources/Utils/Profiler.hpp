@@ -0,0 +1,200 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "NonCopyable.hpp"
+
+namespace acid {
+/**
+ * @brief Records timed scopes and counters of recent frames, and writes them as Chrome trace events.
+ * A disabled profiler only costs a relaxed atomic load per scope or counter.
+ */
+class ACID_EXPORT Profiler : public NonCopyable {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	/// Counters reset at the start of each frame.
+	enum class Counter {
+		/// Entities whose queued actions were executed by UpdateEntities.
+		Actions,
+		/// OnEntityAttach callbacks.
+		Attaches,
+		/// OnEntityDetach callbacks.
+		Detaches,
+		/// OnEntityEnable callbacks.
+		Enables,
+		/// OnEntityDisable callbacks.
+		Disables,
+		Count
+	};
+
+	/**
+	 * @brief A timed scope.
+	 */
+	class Event {
+	public:
+		/// Scope name, must outlive the profiler.
+		const char *name;
+
+		/// Start time and duration in nanoseconds, the start is relative to the profiler creation.
+		std::int64_t start;
+		std::int64_t duration;
+
+		/// Index of the thread the scope ran on, in order of first use.
+		std::uint32_t thread;
+	};
+
+	/**
+	 * @brief The events and counters of one frame.
+	 */
+	class Frame {
+	public:
+		/// Frame number, counting from 0.
+		std::uint64_t index = 0;
+
+		/// Start time and duration in nanoseconds, the start is relative to the profiler creation.
+		std::int64_t start = 0;
+		std::int64_t duration = 0;
+
+		std::vector<Event> events;
+		std::array<std::uint64_t, static_cast<std::size_t>(Counter::Count)> counters = {};
+	};
+
+	/**
+	 * @brief Times the enclosing scope and records it as an event of the current frame.
+	 */
+	class Scope {
+	public:
+		Scope(Profiler &profiler, const char *name) :
+			profiler(profiler.IsEnabled() ? &profiler : nullptr),
+			name(name) {
+			if (this->profiler) {
+				start = Clock::now();
+			}
+		}
+
+		~Scope() {
+			if (profiler) {
+				profiler->AddEvent(name, start, Clock::now());
+			}
+		}
+
+		Scope(const Scope &) = delete;
+		Scope &operator=(const Scope &) = delete;
+
+	private:
+		Profiler *profiler;
+		const char *name;
+		Clock::time_point start;
+	};
+
+	/**
+	 * Creates a new profiler, disabled.
+	 * @param frameCapacity The number of recent frames kept.
+	 */
+	explicit Profiler(std::size_t frameCapacity = 120);
+
+	/**
+	 * Gets if the profiler records frames.
+	 * @return If the profiler is enabled.
+	 */
+	bool IsEnabled() const noexcept { return enabled.load(std::memory_order_relaxed); }
+
+	/**
+	 * Enables or disables recording, should be called between frames.
+	 * @param enabled If the profiler is enabled.
+	 */
+	void SetEnabled(bool enabled);
+
+	/**
+	 * Starts recording a frame.
+	 */
+	void BeginFrame();
+
+	/**
+	 * Finishes the current frame and stores it into the ring of recent frames, replacing the oldest one.
+	 */
+	void EndFrame();
+
+	/**
+	 * Records a timed scope into the current frame. Can be called from any thread.
+	 * @param name The scope name, must outlive the profiler.
+	 * @param start The scope start time.
+	 * @param end The scope end time.
+	 */
+	void AddEvent(const char *name, Clock::time_point start, Clock::time_point end);
+
+	/**
+	 * Adds to a counter of the current frame. Can be called from any thread.
+	 * @param counter The counter.
+	 * @param amount The amount added.
+	 */
+	void Count(Counter counter, std::uint64_t amount = 1) noexcept {
+		if (IsEnabled()) {
+			counters[static_cast<std::size_t>(counter)].fetch_add(amount, std::memory_order_relaxed);
+		}
+	}
+
+	/**
+	 * Gets the recent frames.
+	 * @return The frames, oldest first.
+	 */
+	std::vector<Frame> GetFrames() const;
+
+	/**
+	 * Removes all recent frames.
+	 */
+	void ClearFrames();
+
+	/**
+	 * Writes the recent frames in the Chrome trace event format, viewable with chrome://tracing or Perfetto.
+	 * @param stream The stream to write into.
+	 */
+	void WriteChromeTrace(std::ostream &stream) const;
+
+	/**
+	 * Gets the name of a counter.
+	 * @param counter The counter.
+	 * @return The counter name.
+	 */
+	static const char *GetCounterName(Counter counter) noexcept;
+
+private:
+	/**
+	 * Gets the time since the profiler creation.
+	 * @param time The time point.
+	 * @return The time in nanoseconds.
+	 */
+	std::int64_t GetTime(Clock::time_point time) const noexcept;
+
+	/**
+	 * Gets the index of the calling thread, must be called with the mutex locked.
+	 * @return The thread index.
+	 */
+	std::uint32_t GetThreadIndex();
+
+	std::atomic<bool> enabled = false;
+	Clock::time_point epoch;
+
+	/// The frame being recorded, its events are guarded by the mutex.
+	Frame current;
+	bool recording = false;
+	std::array<std::atomic<std::uint64_t>, static_cast<std::size_t>(Counter::Count)> counters = {};
+	mutable std::mutex mutex;
+
+	/// Ring of recent frames, next is the slot the next frame is stored.
+	std::vector<Frame> frames;
+	std::size_t next = 0;
+	std::size_t count = 0;
+	std::uint64_t frameIndex = 0;
+
+	std::unordered_map<std::thread::id, std::uint32_t> threads;
+};
+}
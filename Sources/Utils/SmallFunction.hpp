@@ -0,0 +1,172 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace acid {
+template<typename>
+class SmallFunction;
+
+/**
+ * @brief A copyable callable wrapper like std::function, that stores small callables such as lambdas capturing a few pointers inline
+ * instead of allocating them. Larger callables, or callables that may throw when moved, are allocated.
+ * @tparam TReturnType The return type.
+ * @tparam TArgs The argument types.
+ */
+template<typename TReturnType, typename ...TArgs>
+class SmallFunction<TReturnType(TArgs ...)> {
+public:
+	/// Size of the inline storage, callables up to this size are not allocated.
+	static constexpr std::size_t Capacity = 4 * sizeof(void *);
+
+	SmallFunction() noexcept = default;
+
+	SmallFunction(std::nullptr_t) noexcept {
+	}
+
+	template<typename Func, typename = std::enable_if_t<!std::is_same_v<std::decay_t<Func>, SmallFunction> &&
+		std::is_invocable_r_v<TReturnType, std::decay_t<Func> &, TArgs...>>>
+	SmallFunction(Func &&func) {
+		using Callable = std::decay_t<Func>;
+
+		if constexpr (IsInline<Callable>()) {
+			new(&storage) Callable(std::forward<Func>(func));
+		} else {
+			*reinterpret_cast<Callable **>(&storage) = new Callable(std::forward<Func>(func));
+		}
+
+		invoke = &Invoke<Callable>;
+		manage = &Manage<Callable>;
+	}
+
+	SmallFunction(const SmallFunction &other) :
+		invoke(other.invoke),
+		manage(other.manage) {
+		if (manage) {
+			manage(Operation::Copy, &storage, const_cast<Storage *>(&other.storage));
+		}
+	}
+
+	SmallFunction(SmallFunction &&other) noexcept :
+		invoke(other.invoke),
+		manage(other.manage) {
+		if (manage) {
+			manage(Operation::Move, &storage, &other.storage);
+			other.invoke = nullptr;
+			other.manage = nullptr;
+		}
+	}
+
+	~SmallFunction() {
+		Reset();
+	}
+
+	SmallFunction &operator=(const SmallFunction &other) {
+		if (this != &other) {
+			SmallFunction copy(other);
+			*this = std::move(copy);
+		}
+
+		return *this;
+	}
+
+	SmallFunction &operator=(SmallFunction &&other) noexcept {
+		if (this != &other) {
+			Reset();
+
+			if (other.manage) {
+				other.manage(Operation::Move, &storage, &other.storage);
+				invoke = other.invoke;
+				manage = other.manage;
+				other.invoke = nullptr;
+				other.manage = nullptr;
+			}
+		}
+
+		return *this;
+	}
+
+	/**
+	 * Gets if a callable is stored.
+	 * @return If the function can be called.
+	 */
+	explicit operator bool() const noexcept { return invoke != nullptr; }
+
+	TReturnType operator()(TArgs ...args) const {
+		return invoke(const_cast<Storage *>(&storage), std::forward<TArgs>(args)...);
+	}
+
+	/**
+	 * Gets if a callable type is stored inline.
+	 * @tparam Callable The callable type.
+	 * @return If the callable is not allocated.
+	 */
+	template<typename Callable>
+	static constexpr bool IsInline() noexcept {
+		return sizeof(Callable) <= Capacity && alignof(Callable) <= alignof(std::max_align_t) && std::is_nothrow_move_constructible_v<Callable>;
+	}
+
+private:
+	enum class Operation {
+		Copy, Move, Destroy
+	};
+
+	using Storage = std::aligned_storage_t<Capacity, alignof(std::max_align_t)>;
+
+	template<typename Callable>
+	static Callable *Get(Storage *storage) noexcept {
+		if constexpr (IsInline<Callable>()) {
+			return std::launder(reinterpret_cast<Callable *>(storage));
+		} else {
+			return *reinterpret_cast<Callable **>(storage);
+		}
+	}
+
+	template<typename Callable>
+	static TReturnType Invoke(Storage *storage, TArgs &&...args) {
+		return (*Get<Callable>(storage))(std::forward<TArgs>(args)...);
+	}
+
+	template<typename Callable>
+	static void Manage(Operation operation, Storage *to, Storage *from) {
+		switch (operation) {
+		case Operation::Copy:
+			if constexpr (IsInline<Callable>()) {
+				new(to) Callable(*Get<Callable>(from));
+			} else {
+				*reinterpret_cast<Callable **>(to) = new Callable(*Get<Callable>(from));
+			}
+			break;
+		case Operation::Move:
+			if constexpr (IsInline<Callable>()) {
+				new(to) Callable(std::move(*Get<Callable>(from)));
+				Get<Callable>(from)->~Callable();
+			} else {
+				*reinterpret_cast<Callable **>(to) = Get<Callable>(from);
+			}
+			break;
+		case Operation::Destroy:
+			if constexpr (IsInline<Callable>()) {
+				Get<Callable>(to)->~Callable();
+			} else {
+				delete Get<Callable>(to);
+			}
+			break;
+		}
+	}
+
+	void Reset() noexcept {
+		if (manage) {
+			manage(Operation::Destroy, &storage, nullptr);
+			invoke = nullptr;
+			manage = nullptr;
+		}
+	}
+
+	Storage storage;
+	TReturnType (*invoke)(Storage *, TArgs &&...) = nullptr;
+	void (*manage)(Operation, Storage *, Storage *) = nullptr;
+};
+}
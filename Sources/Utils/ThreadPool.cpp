@@ -0,0 +1,162 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace acid {
+namespace {
+/// The pool the calling thread works for, and its worker index.
+thread_local const ThreadPool *currentPool = nullptr;
+thread_local std::size_t currentIndex = 0;
+}
+
+ThreadPool::ThreadPool(std::size_t threadCount) {
+	for (std::size_t i = 0; i < threadCount; ++i) {
+		workers.emplace_back(std::make_unique<Worker>());
+	}
+
+	// Threads start once every queue exists, so workers can steal from any of them.
+	for (std::size_t i = 0; i < threadCount; ++i) {
+		workers[i]->thread = std::thread(&ThreadPool::WorkerLoop, this, i);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		stopping = true;
+	}
+
+	sleepCondition.notify_all();
+
+	for (auto &worker : workers) {
+		worker->thread.join();
+	}
+}
+
+void ThreadPool::Run(TaskGroup &group, Task &&task) {
+	group.pending.fetch_add(1, std::memory_order_relaxed);
+
+	// Without workers the task is run right away.
+	if (workers.empty()) {
+		std::pair<Task, TaskGroup *> pair(std::move(task), &group);
+		Execute(pair);
+		return;
+	}
+
+	auto index = GetWorkerIndex();
+
+	if (index == workers.size()) {
+		index = nextQueue.fetch_add(1, std::memory_order_relaxed) % workers.size();
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(workers[index]->mutex);
+		workers[index]->tasks.emplace_back(std::move(task), &group);
+	}
+
+	queued.fetch_add(1, std::memory_order_release);
+
+	{
+		// Locking makes sure a worker about to sleep sees the new task.
+		std::lock_guard<std::mutex> lock(sleepMutex);
+	}
+
+	sleepCondition.notify_one();
+}
+
+void ThreadPool::Wait(TaskGroup &group) {
+	const auto index = std::min(GetWorkerIndex(), workers.size() - 1);
+	std::pair<Task, TaskGroup *> task;
+
+	while (!group.IsDone()) {
+		if (!workers.empty() && TakeTask(index, task)) {
+			Execute(task);
+		} else {
+			std::this_thread::yield();
+		}
+	}
+
+	std::exception_ptr exception;
+
+	{
+		std::lock_guard<std::mutex> lock(group.exceptionMutex);
+		exception = std::exchange(group.exception, nullptr);
+	}
+
+	if (exception) {
+		std::rethrow_exception(exception);
+	}
+}
+
+std::size_t ThreadPool::GetWorkerIndex() const noexcept {
+	return currentPool == this ? currentIndex : workers.size();
+}
+
+void ThreadPool::WorkerLoop(std::size_t index) {
+	currentPool = this;
+	currentIndex = index;
+
+	std::pair<Task, TaskGroup *> task;
+
+	while (true) {
+		if (TakeTask(index, task)) {
+			Execute(task);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		sleepCondition.wait(lock, [this] {
+			return stopping || queued.load(std::memory_order_acquire) != 0;
+		});
+
+		if (stopping) {
+			return;
+		}
+	}
+}
+
+bool ThreadPool::TakeTask(std::size_t index, std::pair<Task, TaskGroup *> &task) {
+	if (queued.load(std::memory_order_acquire) == 0) {
+		return false;
+	}
+
+	for (std::size_t i = 0; i < workers.size(); ++i) {
+		auto &worker = *workers[(index + i) % workers.size()];
+		std::lock_guard<std::mutex> lock(worker.mutex);
+
+		if (worker.tasks.empty()) {
+			continue;
+		}
+
+		// The owner takes its newest task, thieves take the oldest.
+		if (i == 0) {
+			task = std::move(worker.tasks.back());
+			worker.tasks.pop_back();
+		} else {
+			task = std::move(worker.tasks.front());
+			worker.tasks.pop_front();
+		}
+
+		queued.fetch_sub(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	return false;
+}
+
+void ThreadPool::Execute(std::pair<Task, TaskGroup *> &task) {
+	try {
+		task.first();
+	} catch (...) {
+		std::lock_guard<std::mutex> lock(task.second->exceptionMutex);
+
+		if (!task.second->exception) {
+			task.second->exception = std::current_exception();
+		}
+	}
+
+	task.first = nullptr;
+	task.second->pending.fetch_sub(1, std::memory_order_acq_rel);
+}
+}
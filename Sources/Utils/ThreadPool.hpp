@@ -0,0 +1,115 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "NonCopyable.hpp"
+
+namespace acid {
+/**
+ * @brief A work-stealing thread pool. Each worker owns a task queue, it takes its own tasks from the back and steals the oldest tasks of other workers from the front.
+ */
+class ACID_EXPORT ThreadPool : public NonCopyable {
+public:
+	using Task = std::function<void()>;
+
+	/**
+	 * @brief Counts the tasks of a batch that are still running, so they can be waited on together.
+	 * The first exception thrown by a task of the group is kept, and rethrown when the group is waited on.
+	 */
+	class TaskGroup {
+		friend class ThreadPool;
+	public:
+		/**
+		 * Gets if all tasks of this group have finished.
+		 * @return If the group is done.
+		 */
+		bool IsDone() const noexcept { return pending.load(std::memory_order_acquire) == 0; }
+
+	private:
+		std::atomic<std::size_t> pending = 0;
+		std::mutex exceptionMutex;
+		std::exception_ptr exception;
+	};
+
+	/**
+	 * Creates a new thread pool.
+	 * @param threadCount The number of worker threads, with 0 tasks are run on the calling thread.
+	 */
+	explicit ThreadPool(std::size_t threadCount = std::thread::hardware_concurrency());
+	~ThreadPool();
+
+	/**
+	 * Queues a task. When called from a worker of this pool the task goes to that worker queue.
+	 * @param group The group the task belongs to.
+	 * @param task The task.
+	 */
+	void Run(TaskGroup &group, Task &&task);
+
+	/**
+	 * Waits for all tasks of a group, running queued tasks on the calling thread meanwhile.
+	 * Rethrows the first exception thrown by a task of the group, once all of its tasks have finished.
+	 * @param group The group.
+	 */
+	void Wait(TaskGroup &group);
+
+	/**
+	 * Gets the number of worker threads.
+	 * @return The number of workers.
+	 */
+	std::size_t GetThreadCount() const noexcept { return workers.size(); }
+
+	/**
+	 * Gets the index of the calling thread in this pool.
+	 * @return The worker index, or GetThreadCount() if the calling thread is not a worker of this pool.
+	 */
+	std::size_t GetWorkerIndex() const noexcept;
+
+private:
+	class Worker {
+	public:
+		std::thread thread;
+		std::mutex mutex;
+		std::deque<std::pair<Task, TaskGroup *>> tasks;
+	};
+
+	/**
+	 * The loop run by each worker thread.
+	 * @param index The worker index.
+	 */
+	void WorkerLoop(std::size_t index);
+
+	/**
+	 * Takes a task, from the back of the worker queue first, then from the front of the other queues.
+	 * @param index The index of the worker to take from first.
+	 * @param task The taken task.
+	 * @return If a task was taken.
+	 */
+	bool TakeTask(std::size_t index, std::pair<Task, TaskGroup *> &task);
+
+	/**
+	 * Runs a task and marks it done within its group, keeping the exception it throws for the group.
+	 * @param task The task.
+	 */
+	static void Execute(std::pair<Task, TaskGroup *> &task);
+
+	std::vector<std::unique_ptr<Worker>> workers;
+
+	/// Number of tasks waiting in all queues.
+	std::atomic<std::size_t> queued = 0;
+
+	/// Round-robin queue selection for tasks queued from outside the pool.
+	std::atomic<std::size_t> nextQueue = 0;
+
+	std::mutex sleepMutex;
+	std::condition_variable sleepCondition;
+	bool stopping = false;
+};
+}
@@ -1,7 +1,8 @@
 #pragma once
 
-#include <typeindex>
-#include <unordered_map>
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
 
 namespace acid {
 using TypeId = std::size_t;
@@ -13,17 +14,19 @@ public:
 
 	/**
 	 * Get the type ID of K which is a base of T.
+	 * The ID is assigned on the first call for K, later calls only read it. Safe to call from any thread.
 	 * @tparam K The type ID K.
 	 * @return The type ID.
 	 */
 	template<typename K>
 	static TypeId GetTypeId() noexcept {
-		std::type_index typeIndex(typeid(K));
-		if (auto it = typeMap.find(typeIndex); it != typeMap.end())
-			return it->second;
-		const auto id = NextTypeId();
-		typeMap[typeIndex] = id;
-		return id;
+		// Like typeid, cv-qualifiers and references do not make a distinct type.
+		if constexpr (!std::is_same_v<K, std::remove_cv_t<std::remove_reference_t<K>>>) {
+			return GetTypeId<std::remove_cv_t<std::remove_reference_t<K>>>();
+		} else {
+			static const TypeId id = NextTypeId();
+			return id;
+		}
 	}
 
 private:
@@ -32,19 +35,13 @@ private:
 	 * @return The next type ID for T.
 	 */
 	static TypeId NextTypeId() noexcept {
-		const auto id = nextTypeId;
-		++nextTypeId;
-		return id;
+		return nextTypeId.fetch_add(1, std::memory_order_relaxed);
 	}
 
 	// Next type ID for T.
-	static TypeId nextTypeId;
-	static std::unordered_map<std::type_index, TypeId> typeMap;
+	static std::atomic<TypeId> nextTypeId;
 };
 
 template<typename K>
-TypeId TypeInfo<K>::nextTypeId = 0;
-
-template<typename K>
-std::unordered_map<std::type_index, TypeId> TypeInfo<K>::typeMap = {};
+std::atomic<TypeId> TypeInfo<K>::nextTypeId = 0;
 }
@@ -0,0 +1,35 @@
+#include "TypeName.hpp"
+
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <typeindex>
+#include <unordered_map>
+
+#if defined(__GNUG__)
+#include <cxxabi.h>
+#endif
+
+namespace acid {
+const char *GetTypeName(const std::type_info &type) {
+	static std::mutex mutex;
+	// Nodes never move, so the returned names stay valid as the map grows.
+	static std::unordered_map<std::type_index, std::string> names;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	auto [it, inserted] = names.try_emplace(type);
+
+	if (inserted) {
+#if defined(__GNUG__)
+		int status = 0;
+		std::unique_ptr<char, decltype(&std::free)> demangled(abi::__cxa_demangle(type.name(), nullptr, nullptr, &status), &std::free);
+		it->second = status == 0 && demangled ? demangled.get() : type.name();
+#else
+		it->second = type.name();
+#endif
+	}
+
+	return it->second.c_str();
+}
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <typeinfo>
+
+#include "Export.hpp"
+
+namespace acid {
+/**
+ * Gets the readable name of a type, demangled where the compiler mangles type names.
+ * Each type is demangled once, the names are kept for the lifetime of the program.
+ * @param type The type.
+ * @return The type name.
+ */
+ACID_EXPORT const char *GetTypeName(const std::type_info &type);
+}
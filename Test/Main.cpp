@@ -63,14 +63,9 @@ public:
 	}
 
 	void Update(float delta) override {
-		ForEach([](Entity entity) {
-			if (auto rigidbody = entity.GetComponent<Rigidbody>()) {
-				rigidbody->colliders[0]->SetLocalTransform(*entity.GetComponent<Transform>());
-			}
-		});
-		/*ForEach([](Entity entity, Transform *transform, Rigidbody *rigidbody) {
+		ForEach([](Entity, Transform *transform, Rigidbody *rigidbody) {
 			rigidbody->colliders[0]->SetLocalTransform(*transform);
-		});*/
+		});
 	}
 };
 
@@ -193,8 +188,7 @@ int main(int argc, char **argv) {
 	}
 
 	auto entitySkybox = scene->CreateEntity();
-	entitySkybox.AddComponent<Transform>();
-	entitySkybox.AddComponent<Mesh>(std::make_unique<Model>("Cube.obj"), std::make_unique<MaterialSkybox>());
+	entitySkybox.AddComponents(Transform(), Mesh(std::make_unique<Model>("Cube.obj"), std::make_unique<MaterialSkybox>()));
 
 	scene->Update(1.0f / 60.0f);
 	//entitySkybox.Remove();